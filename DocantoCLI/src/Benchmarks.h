@@ -0,0 +1,62 @@
+#ifndef _DOCANTOCLI_BENCHMARKS_H_
+#define _DOCANTOCLI_BENCHMARKS_H_
+
+#include "DocantoLib.h"
+
+/// <summary>
+/// Returns the given file if it is one, else all PDF files in the directory and its subdirectories
+/// </summary>
+std::vector<std::filesystem::path> collect_pdfs(const std::filesystem::path& p);
+
+/// <summary>
+/// The amount of threads the benchmarks are run with, the powers of two up to the amount of hardware threads
+/// </summary>
+std::vector<size_t> get_thread_counts();
+
+/// <summary>
+/// Escapes the string so it can be written into a JSON string literal
+/// </summary>
+std::string json_escape(const std::string& s);
+
+/// <summary>
+/// Renders the first viewport of every PDF at different dpis and measures how long requesting the complete viewport
+/// again takes, which is mostly the culling of the drawn and queued tiles. It is measured again after scrolling
+/// through the document, the tiles of the other pages must not make it slower. One viewport is several windows large
+/// so more than a thousand tiles are drawn, and the pairwise culling that was used before the tiles were indexed is
+/// timed on the same tiles as reference.
+/// </summary>
+/// <param name="p">A PDF file or a directory which will be searched for PDF files</param>
+/// <param name="output">The file the results are written to as JSON</param>
+void benchmark_culling(const std::filesystem::path& p, const std::filesystem::path& output);
+
+/// <summary>
+/// Measures how long it takes to build the display lists of every PDF against the amount of threads used
+/// </summary>
+/// <param name="p">A PDF file or a directory which will be searched for PDF files</param>
+void benchmark_display_lists(const std::filesystem::path& p);
+
+/// <summary>
+/// Renders the first viewport of every PDF from scratch at different dpis and amounts of render threads. Reports the
+/// latency of the tiles, the throughput, the time until the viewport is complete and the peak memory usage.
+/// </summary>
+/// <param name="p">A PDF file or a directory which will be searched for PDF files</param>
+/// <param name="output">The file the results are written to as JSON</param>
+void benchmark_tiles(const std::filesystem::path& p, const std::filesystem::path& output);
+
+/// <summary>
+/// Replays a recorded viewport trace at its original pace. Reports how long the viewport was blurry, how many
+/// render jobs were cancelled and how much of the rendering work was never shown.
+/// </summary>
+/// <param name="trace">A trace written by PDFViewportTrace::save</param>
+/// <param name="output">The file the results are written to as JSON</param>
+/// <param name="chrome_trace">If not empty the render pipeline is traced during the replay and written to this file</param>
+void benchmark_replay(const std::filesystem::path& trace, const std::filesystem::path& output, const std::filesystem::path& chrome_trace = {});
+
+/// <summary>
+/// Measures how many lock and unlock pairs the ReentrantSharedMutex, the previous ReadWriteThreadSafeMutex and
+/// std::shared_mutex manage with 1 to 32 threads for different amounts of writes
+/// </summary>
+/// <param name="output">The file the results are written to as JSON</param>
+void benchmark_mutex(const std::filesystem::path& output);
+
+#endif // !_DOCANTOCLI_BENCHMARKS_H_
@@ -0,0 +1,290 @@
+#include "Benchmarks.h"
+#include "HeadlessImageProcessor.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <cmath>
+
+using namespace Docanto;
+
+#define FLOAT_EQUAL(a, b) (std::abs(a - b) < 0.001)
+
+namespace {
+    // the size of the window the viewport is shown in
+    constexpr float VIEW_WIDTH = 1280;
+    constexpr float VIEW_HEIGHT = 800;
+    constexpr auto VIEW_TIMEOUT = std::chrono::seconds(60);
+    // how many requests of a complete viewport are timed
+    constexpr size_t ROUNDS = 200;
+    // the pairwise culling is much slower on the large viewports, so it is timed less often
+    constexpr size_t REFERENCE_ROUNDS = 20;
+
+    struct Scenario {
+        float dpi = 96;
+        // the viewport covers this many windows per axis, like a very large screen
+        float view_scale = 1;
+        // how many viewports below the first one are rendered before it is measured again
+        size_t scroll_steps = 16;
+    };
+
+    // the large viewport at high dpi keeps more than a thousand tiles alive, which is where the culling cost shows
+    const std::vector<Scenario> SCENARIOS = {
+        { 96, 1, 16 },
+        { 192, 1, 16 },
+        { 384, 1, 16 },
+        { 384, 4, 2 },
+    };
+
+    struct CullingResult {
+        std::filesystem::path file;
+        Scenario scenario;
+
+        // the tiles which are drawn for the first viewport
+        size_t tiles_drawn = 0;
+        double request_us = 0;
+        // the pairwise culling the renderer used before the tiles were indexed, run on the drawn tiles
+        double reference_us = 0;
+
+        // the same viewport after scrolling through the document and back
+        size_t tiles_cached = 0;
+        double request_after_scroll_us = 0;
+        bool timed_out = false;
+    };
+
+    struct Tile {
+        Geometry::Rectangle<float> recs;
+        float dpi = 0;
+        size_t page = 0;
+    };
+
+    /// <summary>
+    /// The way PDFRenderer culled before the tile index existed. Every chunk of a page is compared with every
+    /// bitmap and job, and every bitmap which is not at the target dpi with every other bitmap.
+    /// </summary>
+    /// <returns>The amount of culled chunks and bitmaps, so the work can not be optimized away</returns>
+    size_t cull_pairwise(const std::vector<Tile>& tiles, size_t amount_pages, float target_dpi) {
+        auto same_chunk = [](const Geometry::Rectangle<float>& a, const Geometry::Rectangle<float>& b) {
+            return FLOAT_EQUAL(a.x, b.x) and FLOAT_EQUAL(a.y, b.y) and
+                FLOAT_EQUAL(a.width, b.width) and FLOAT_EQUAL(a.height, b.height);
+        };
+
+        // the viewport is complete, so every chunk is drawn and nothing is queued
+        const auto& bitmaps = tiles;
+        const std::vector<Tile> jobs;
+        size_t culled = 0;
+
+        for (size_t page = 0; page < amount_pages; page++) {
+            std::vector<Tile> chunks;
+            std::copy_if(tiles.begin(), tiles.end(), std::back_inserter(chunks), [page](const Tile& t) { return t.page == page; });
+
+            for (auto it = chunks.begin(); it != chunks.end();) {
+                bool del = false;
+                for (const auto& b : bitmaps) {
+                    if (b.page == page and FLOAT_EQUAL(b.dpi, it->dpi) and same_chunk(b.recs, it->recs)) {
+                        del = true;
+                        break;
+                    }
+                }
+                for (size_t j = 0; !del and j < jobs.size(); j++) {
+                    del = jobs[j].page == page and FLOAT_EQUAL(jobs[j].dpi, it->dpi) and same_chunk(jobs[j].recs, it->recs);
+                }
+
+                if (del) {
+                    it = chunks.erase(it);
+                    culled++;
+                }
+                else {
+                    it++;
+                }
+            }
+
+            for (const auto& item : bitmaps) {
+                if (item.page != page or FLOAT_EQUAL(item.dpi, target_dpi)) {
+                    continue;
+                }
+
+                for (const auto& other : bitmaps) {
+                    if (other.page == page and FLOAT_EQUAL(other.dpi, target_dpi) and item.dpi > other.dpi and item.recs.intersects(other.recs)) {
+                        culled++;
+                        break;
+                    }
+                }
+            }
+        }
+
+        return culled;
+    }
+
+    /// <summary>
+    /// Drives a renderer like the window does: the viewport is requested again after every batch of finished tiles
+    /// </summary>
+    class ViewportDriver {
+    public:
+        ViewportDriver(const std::filesystem::path& file) {
+            m_processor = std::make_shared<HeadlessImageProcessor>();
+            m_notifier = std::make_shared<PDFRenderNotifier>([this](const PDFRenderNotifier::Batch&) {
+                {
+                    std::scoped_lock<std::mutex> lock(m_batch_mutex);
+                    m_amount_batches++;
+                }
+                m_batch_condition.notify_all();
+            });
+            m_notifier->set_flush_on_complete(true);
+
+            renderer = std::make_unique<PDFRenderer>(std::make_shared<PDF>(file), m_processor);
+            renderer->set_render_notifier(m_notifier);
+            // only the tiles of the viewport are culled
+            renderer->set_preview_budget(0);
+            renderer->set_prefetch_budget(0);
+        }
+
+        /// <returns>False if the viewport was not complete in time</returns>
+        bool render(const Geometry::Rectangle<float>& view, float dpi, std::chrono::seconds timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            renderer->request(view, dpi);
+
+            while (!m_notifier->is_complete()) {
+                std::unique_lock<std::mutex> lock(m_batch_mutex);
+                if (!m_batch_condition.wait_until(lock, deadline, [&] { return m_amount_batches != m_seen_batches; })) {
+                    return false;
+                }
+                m_seen_batches = m_amount_batches;
+                lock.unlock();
+
+                renderer->request(view, dpi);
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Requests the complete viewport again, nothing is queued so only the culling is measured
+        /// </summary>
+        /// <returns>The average time of a request in us</returns>
+        double measure(const Geometry::Rectangle<float>& view, float dpi) {
+            Timer time;
+            for (size_t i = 0; i < ROUNDS; i++) {
+                renderer->request(view, dpi);
+            }
+            return static_cast<double>(time.delta_us()) / ROUNDS;
+        }
+
+        /// <summary>
+        /// Culls the drawn tiles of the renderer the way it was done before they were indexed
+        /// </summary>
+        /// <returns>The average time of a culling pass in us</returns>
+        double measure_reference(float dpi) {
+            std::vector<Tile> tiles;
+            size_t amount_pages = 0;
+            auto collect = [&](const auto& list) {
+                for (const auto& info : *list) {
+                    tiles.push_back({ info.recs, info.dpi, info.page });
+                    amount_pages = std::max(amount_pages, info.page + 1);
+                }
+            };
+            collect(renderer->draw());
+            collect(renderer->annot());
+
+            size_t culled = 0;
+            Timer time;
+            for (size_t i = 0; i < REFERENCE_ROUNDS; i++) {
+                culled += cull_pairwise(tiles, amount_pages, dpi);
+            }
+            double us = static_cast<double>(time.delta_us()) / REFERENCE_ROUNDS;
+
+            if (culled == 0 and !tiles.empty()) {
+                Logger::warn("[Culling] The reference culling did not find any of the drawn tiles");
+            }
+            return us;
+        }
+
+        size_t get_amount_drawn() {
+            return renderer->draw()->size() + renderer->annot()->size();
+        }
+
+        std::unique_ptr<PDFRenderer> renderer;
+    private:
+        std::shared_ptr<HeadlessImageProcessor> m_processor;
+        std::shared_ptr<PDFRenderNotifier> m_notifier;
+
+        std::mutex m_batch_mutex;
+        std::condition_variable m_batch_condition;
+        size_t m_amount_batches = 0;
+        size_t m_seen_batches = 0;
+    };
+
+    CullingResult run_culling(const std::filesystem::path& file, const Scenario& scenario) {
+        CullingResult result;
+        result.file = file;
+        result.scenario = scenario;
+
+        float dpi = scenario.dpi;
+        ViewportDriver driver(file);
+        Geometry::Rectangle<float> view = { 0, 0, VIEW_WIDTH * scenario.view_scale * 96 / dpi, VIEW_HEIGHT * scenario.view_scale * 96 / dpi };
+        // the large viewports take longer to render
+        auto timeout = VIEW_TIMEOUT * static_cast<int>(std::ceil(scenario.view_scale * scenario.view_scale));
+
+        if (!driver.render(view, dpi, timeout)) {
+            result.timed_out = true;
+            return result;
+        }
+        result.tiles_drawn = driver.get_amount_drawn();
+        result.request_us = driver.measure(view, dpi);
+        result.reference_us = driver.measure_reference(dpi);
+
+        // the tiles of the pages that were scrolled past stay in the cache, the culling should not get slower
+        auto scrolled = view;
+        for (size_t i = 0; i < scenario.scroll_steps and scrolled.y < driver.renderer->get_max_dimension().height; i++) {
+            scrolled.y += view.height;
+            result.timed_out |= !driver.render(scrolled, dpi, timeout);
+        }
+        result.timed_out |= !driver.render(view, dpi, timeout);
+
+        result.tiles_cached = driver.renderer->get_cache_statistics().amount_tiles;
+        result.request_after_scroll_us = driver.measure(view, dpi);
+        return result;
+    }
+}
+
+void benchmark_culling(const std::filesystem::path& p, const std::filesystem::path& output) {
+    if (!std::filesystem::exists(p)) {
+        Logger::error("[Culling] Could not find ", p);
+        return;
+    }
+
+    std::vector<CullingResult> results;
+
+    for (const auto& file : collect_pdfs(p)) {
+        for (const auto& scenario : SCENARIOS) {
+            auto r = run_culling(file, scenario);
+            Logger::log("[Culling] ", file.filename(), " at ", scenario.dpi, "dpi and ", scenario.view_scale, "x the window: ", r.request_us,
+                "us per request with ", r.tiles_drawn, " tiles drawn (pairwise culling ", r.reference_us, "us), ",
+                r.request_after_scroll_us, "us with ", r.tiles_cached, " tiles cached", r.timed_out ? " (timed out)" : "");
+            results.push_back(std::move(r));
+        }
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        Logger::error("[Culling] Could not write to ", output);
+        return;
+    }
+
+    out << "{\n  \"view\": { \"width\": " << VIEW_WIDTH << ", \"height\": " << VIEW_HEIGHT << " },\n";
+    out << "  \"runs\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results.at(i);
+        out << "    {\n";
+        out << "      \"file\": \"" << json_escape(reinterpret_cast<const char*>(r.file.filename().u8string().c_str())) << "\",\n";
+        out << "      \"dpi\": " << r.scenario.dpi << ",\n";
+        out << "      \"view_scale\": " << r.scenario.view_scale << ",\n";
+        out << "      \"timed_out\": " << (r.timed_out ? "true" : "false") << ",\n";
+        out << "      \"tiles_drawn\": " << r.tiles_drawn << ",\n";
+        out << "      \"request_us\": " << r.request_us << ",\n";
+        out << "      \"pairwise_cull_us\": " << r.reference_us << ",\n";
+        out << "      \"tiles_cached\": " << r.tiles_cached << ",\n";
+        out << "      \"request_after_scroll_us\": " << r.request_after_scroll_us << "\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    Logger::log("[Culling] Wrote ", results.size(), " runs to ", output);
+}
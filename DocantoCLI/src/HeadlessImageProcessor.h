@@ -0,0 +1,91 @@
+#ifndef _DOCANTOCLI_HEADLESSIMAGEPROCESSOR_H_
+#define _DOCANTOCLI_HEADLESSIMAGEPROCESSOR_H_
+
+#include "DocantoLib.h"
+
+#include <chrono>
+#include <unordered_map>
+
+/// <summary>
+/// Renders the tiles into its own buffers instead of a window, like the Direct2D processor would. The time every
+/// tile was started and finished is recorded.
+/// </summary>
+class HeadlessImageProcessor : public Docanto::IPDFRenderImageProcessor {
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    struct Sample {
+        size_t id = 0;
+        clock_type::time_point acquired;
+        // when the tile was committed or cancelled
+        clock_type::time_point finished;
+        bool cancelled = false;
+    };
+
+    void processImage(size_t id, const Docanto::Image& /*img*/) override {
+        auto now = clock_type::now();
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_samples.push_back({ id, now, now, false });
+    }
+
+    void deleteImage(size_t id) override {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_images.erase(id);
+    }
+
+    std::optional<Docanto::ImageTarget> acquireImage(size_t id, const Docanto::Geometry::Dimension<size_t>& dims, size_t /*dpi*/) override {
+        if (dims.width == 0 or dims.height == 0) {
+            return std::nullopt;
+        }
+
+        Docanto::ImageTarget target;
+        target.stride = Docanto::BufferPool::get_aligned_stride(dims.width * 4);
+        auto buffer = Docanto::BufferPool::get_instance().acquire(target.stride * dims.height);
+        target.data = buffer.get();
+
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        m_targets[id] = { std::move(buffer), clock_type::now() };
+        return target;
+    }
+
+    void commitImage(size_t id) override {
+        finish(id, false);
+    }
+
+    void cancelImage(size_t id) override {
+        finish(id, true);
+    }
+
+    std::vector<Sample> get_samples() const {
+        std::scoped_lock<std::mutex> lock(m_mutex);
+        return m_samples;
+    }
+private:
+    struct Target {
+        Docanto::ByteBuffer buffer;
+        clock_type::time_point acquired;
+    };
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<size_t, Target> m_targets;
+    std::unordered_map<size_t, Docanto::ByteBuffer> m_images;
+    std::vector<Sample> m_samples;
+
+    void finish(size_t id, bool cancelled) {
+        auto now = clock_type::now();
+        std::scoped_lock<std::mutex> lock(m_mutex);
+
+        auto it = m_targets.find(id);
+        if (it == m_targets.end()) {
+            return;
+        }
+
+        m_samples.push_back({ id, it->second.acquired, now, cancelled });
+        if (!cancelled) {
+            m_images[id] = std::move(it->second.buffer);
+        }
+        m_targets.erase(it);
+    }
+};
+
+#endif // !_DOCANTOCLI_HEADLESSIMAGEPROCESSOR_H_
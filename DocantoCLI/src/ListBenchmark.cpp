@@ -0,0 +1,76 @@
+#include "Benchmarks.h"
+
+#include <thread>
+
+using namespace Docanto;
+
+namespace {
+    // the display lists are built without rendering anything, so the images are never used
+    class NullImageProcessor : public IPDFRenderImageProcessor {
+    public:
+        void processImage(size_t /*id*/, const Image& /*img*/) override {}
+        void deleteImage(size_t /*id*/) override {}
+    };
+}
+
+std::vector<std::filesystem::path> collect_pdfs(const std::filesystem::path& p) {
+    std::vector<std::filesystem::path> files;
+    if (std::filesystem::is_regular_file(p)) {
+        files.push_back(p);
+        return files;
+    }
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(p)) {
+        if (entry.is_regular_file() and entry.path().extension() == ".pdf") {
+            files.push_back(entry.path());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<size_t> get_thread_counts() {
+    std::vector<size_t> thread_counts = { 1 };
+    size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t i = 2; i < max_threads; i *= 2) {
+        thread_counts.push_back(i);
+    }
+    if (max_threads > 1) {
+        thread_counts.push_back(max_threads);
+    }
+
+    return thread_counts;
+}
+
+void benchmark_display_lists(const std::filesystem::path& p) {
+    if (!std::filesystem::exists(p)) {
+        Logger::error("[Lists] Could not find ", p);
+        return;
+    }
+
+    auto processor = std::make_shared<NullImageProcessor>();
+    for (const auto& file : collect_pdfs(p)) {
+        auto pdf = std::make_shared<PDF>(file);
+        PDFRenderer renderer(pdf, processor);
+
+        // the first build fills the caches of mupdf (fonts, images), it is not measured
+        renderer.update();
+
+        Timer serial_time;
+        renderer.update();
+        auto serial_ms = serial_time.delta_ms();
+
+        Logger::log("[Lists] ", file.filename(), " (", pdf->get_page_count(), " pages)");
+        Logger::log("[Lists]   update():          ", serial_ms, "ms");
+
+        for (auto threads : get_thread_counts()) {
+            Timer parallel_time;
+            renderer.update_parallel(threads);
+            auto parallel_ms = parallel_time.delta_ms();
+
+            Logger::log("[Lists]   update_parallel(", threads, "): ", parallel_ms, "ms, speedup ",
+                static_cast<double>(serial_ms) / std::max<long long>(parallel_ms, 1), "x");
+        }
+    }
+}
@@ -0,0 +1,223 @@
+#include "Benchmarks.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+
+using namespace Docanto;
+
+namespace {
+    constexpr auto RUN_DURATION = std::chrono::milliseconds(300);
+
+    // the ReadWriteThreadSafeMutex before it was built on the ReentrantSharedMutex
+    class LegacyReadWriteMutex {
+        enum class Access {
+            READ,
+            WRITE,
+            NONE
+        };
+
+        struct ThreadInfo {
+            size_t read_locks = 0;
+            size_t write_locks = 0;
+            Access access = Access::NONE;
+        };
+
+        struct QueueItem {
+            std::thread::id id;
+            Access requested = Access::NONE;
+        };
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::map<std::thread::id, ThreadInfo> m_threads;
+        std::queue<QueueItem> m_queue;
+
+        void add(std::thread::id id, Access access) {
+            auto& info = m_threads.try_emplace(id, ThreadInfo{ 0, 0, access }).first->second;
+            (access == Access::READ ? info.read_locks : info.write_locks)++;
+        }
+
+        void remove(std::thread::id id, Access access) {
+            auto it = m_threads.find(id);
+            if (it == m_threads.end()) {
+                return;
+            }
+
+            auto& info = it->second;
+            (access == Access::READ ? info.read_locks : info.write_locks)--;
+            if (info.read_locks == 0 and info.write_locks == 0) {
+                m_threads.erase(it);
+            }
+            else if (info.write_locks == 0) {
+                info.access = Access::READ;
+            }
+        }
+
+        bool can_lock(std::thread::id id, Access access) const {
+            for (const auto& [other, info] : m_threads) {
+                if (other != id and (access == Access::WRITE or info.access == Access::WRITE)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void acquire(Access access) {
+            auto id = std::this_thread::get_id();
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            auto held = m_threads.find(id);
+            bool reentrant = held != m_threads.end() and (access == Access::READ or held->second.access == Access::WRITE);
+            if ((m_queue.empty() and can_lock(id, access)) or reentrant) {
+                add(id, access);
+                m_condition.notify_all();
+                return;
+            }
+
+            m_queue.push({ id, access });
+            m_condition.wait(lock, [&] {
+                const auto& front = m_queue.front();
+                return front.id == id and front.requested == access and can_lock(id, access);
+            });
+            m_queue.pop();
+            add(id, access);
+            m_condition.notify_all();
+        }
+
+        void release(Access access) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            remove(std::this_thread::get_id(), access);
+            m_condition.notify_all();
+        }
+    public:
+        void lock_shared() { acquire(Access::READ); }
+        void unlock_shared() { release(Access::READ); }
+        void lock() { acquire(Access::WRITE); }
+        void unlock() { release(Access::WRITE); }
+    };
+
+    struct MutexResult {
+        std::string name;
+        size_t threads = 0;
+        double write_fraction = 0;
+
+        size_t operations = 0;
+        double duration_ms = 0;
+    };
+
+    // about as much work as a draw() does while it holds the lock
+    struct SharedData {
+        std::array<uint64_t, 16> values = {};
+    };
+
+    template <typename Mutex>
+    MutexResult run_contention(const char* name, size_t amount_threads, double write_fraction) {
+        Mutex mutex;
+        SharedData data;
+        std::atomic_bool running = false;
+        std::atomic_bool stop = false;
+        std::atomic_size_t ready = 0;
+        std::atomic_size_t operations = 0;
+        std::atomic<uint64_t> checksum = 0;
+
+        // every thread writes at fixed intervals, so all locks see the same sequence of operations
+        size_t write_interval = write_fraction > 0 ? static_cast<size_t>(1.0 / write_fraction) : 0;
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < amount_threads; i++) {
+            threads.emplace_back([&, i] {
+                ready++;
+                while (!running) {
+                    std::this_thread::yield();
+                }
+
+                size_t amount = 0;
+                uint64_t sum = 0;
+                while (!stop) {
+                    // the threads are offset so their writes do not line up
+                    if (write_interval != 0 and (amount + i) % write_interval == 0) {
+                        std::scoped_lock<Mutex> lock(mutex);
+                        for (auto& v : data.values) {
+                            v++;
+                        }
+                    }
+                    else {
+                        std::shared_lock<Mutex> lock(mutex);
+                        for (auto v : data.values) {
+                            sum += v;
+                        }
+                    }
+                    amount++;
+                }
+
+                operations += amount;
+                checksum += sum;
+            });
+        }
+
+        while (ready != amount_threads) {
+            std::this_thread::yield();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        running = true;
+        std::this_thread::sleep_for(RUN_DURATION);
+        stop = true;
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        MutexResult result;
+        result.name = name;
+        result.threads = amount_threads;
+        result.write_fraction = write_fraction;
+        result.operations = operations;
+        result.duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    double get_operations_per_second(const MutexResult& r) {
+        return r.duration_ms > 0 ? r.operations / (r.duration_ms / 1000.0) : 0;
+    }
+}
+
+void benchmark_mutex(const std::filesystem::path& output) {
+    const std::vector<size_t> thread_counts = { 1, 2, 4, 8, 16, 32 };
+    // only reads, about as many writes as the renderer does while scrolling and a write heavy mix
+    const std::vector<double> write_fractions = { 0.0, 0.01, 0.1 };
+
+    std::vector<MutexResult> results;
+    for (auto write_fraction : write_fractions) {
+        for (auto threads : thread_counts) {
+            std::array<MutexResult, 3> runs = {
+                run_contention<LegacyReadWriteMutex>("legacy", threads, write_fraction),
+                run_contention<ReentrantSharedMutex>("reentrant", threads, write_fraction),
+                run_contention<std::shared_mutex>("shared_mutex", threads, write_fraction),
+            };
+
+            Logger::log("[Mutex] ", threads, " threads, ", write_fraction * 100, "% writes: legacy ", get_operations_per_second(runs.at(0)) / 1e6,
+                ", reentrant ", get_operations_per_second(runs.at(1)) / 1e6, ", shared_mutex ", get_operations_per_second(runs.at(2)) / 1e6, " Mops/s");
+
+            for (auto& r : runs) {
+                results.push_back(std::move(r));
+            }
+        }
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        Logger::error("[Mutex] Could not write to ", output);
+        return;
+    }
+
+    out << "{\n  \"runs\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results.at(i);
+        out << "    { \"mutex\": \"" << r.name << "\", \"threads\": " << r.threads << ", \"write_fraction\": " << r.write_fraction
+            << ", \"operations\": " << r.operations << ", \"duration_ms\": " << r.duration_ms
+            << ", \"operations_per_second\": " << get_operations_per_second(r) << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    Logger::log("[Mutex] Wrote ", results.size(), " runs to ", output);
+}
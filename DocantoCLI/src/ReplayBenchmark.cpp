@@ -0,0 +1,289 @@
+#include "Benchmarks.h"
+#include "HeadlessImageProcessor.h"
+
+#include <condition_variable>
+#include <unordered_set>
+
+using namespace Docanto;
+
+namespace {
+    typedef HeadlessImageProcessor::clock_type clock_type;
+
+    // how long the replay waits for the last viewport to become sharp
+    constexpr auto TAIL_TIMEOUT = std::chrono::seconds(30);
+
+    struct ReplayResult {
+        size_t amount_events = 0;
+        double duration_ms = 0;
+        // how much later than recorded the events were replayed
+        double max_lag_ms = 0;
+
+        // the time in which at least one visible tile was missing
+        double blurry_ms = 0;
+        double blurry_max_ms = 0;
+        size_t blurry_episodes = 0;
+        bool timed_out = false;
+
+        size_t tiles_rendered = 0;
+        size_t tiles_shown = 0;
+        size_t jobs_cancelled = 0;
+
+        double render_ms = 0;
+        // the time spent on tiles that were never drawn
+        double unused_render_ms = 0;
+        // the time spent on jobs which were aborted
+        double cancelled_render_ms = 0;
+    };
+
+    double to_ms(clock_type::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+}
+
+void benchmark_replay(const std::filesystem::path& trace_path, const std::filesystem::path& output, const std::filesystem::path& chrome_trace) {
+    auto trace = PDFViewportTrace::load(trace_path);
+    if (trace == nullptr) {
+        return;
+    }
+
+    auto events = trace->get_events();
+    if (events.empty()) {
+        Logger::error("[Replay] The trace ", trace_path, " is empty");
+        return;
+    }
+
+    std::mutex batch_mutex;
+    std::condition_variable batch_condition;
+    size_t amount_batches = 0;
+
+    auto processor = std::make_shared<HeadlessImageProcessor>();
+    auto notifier = std::make_shared<PDFRenderNotifier>([&](const PDFRenderNotifier::Batch&) {
+        {
+            std::scoped_lock<std::mutex> lock(batch_mutex);
+            amount_batches++;
+        }
+        batch_condition.notify_all();
+    });
+    notifier->set_flush_on_complete(true);
+
+    // the documents are opened before the clock starts, like they were when the trace was recorded
+    std::map<size_t, std::shared_ptr<PDFRenderer>> renderers;
+    for (const auto& doc : trace->get_documents()) {
+        if (!std::filesystem::exists(doc.path)) {
+            Logger::error("[Replay] Could not find ", doc.path);
+            return;
+        }
+
+        auto renderer = std::make_shared<PDFRenderer>(std::make_shared<PDF>(doc.path), processor);
+        renderer->set_render_notifier(notifier);
+        renderers[doc.id] = renderer;
+    }
+
+    ReplayResult result;
+    result.amount_events = events.size();
+
+    // the last viewport of every document, it is requested again after every batch like a repaint would
+    std::map<size_t, std::pair<Geometry::Rectangle<float>, float>> views;
+    std::unordered_set<size_t> shown;
+    bool blurry = false;
+    clock_type::time_point blurry_since;
+
+    // the drawn tiles are only sampled after each event, a tile which is replaced in between is counted as unused
+    auto update = [&](clock_type::time_point now) {
+        for (const auto& [_, r] : renderers) {
+            auto content = r->draw();
+            auto annotations = r->annot();
+            auto previews = r->get_preview();
+
+            for (const auto* list : { &*content, &*annotations, &*previews }) {
+                for (const auto& info : *list) {
+                    shown.insert(info.id);
+                }
+            }
+        }
+
+        bool complete = notifier->is_complete();
+        if (!complete and !blurry) {
+            blurry = true;
+            blurry_since = now;
+            result.blurry_episodes++;
+        }
+        else if (complete and blurry) {
+            blurry = false;
+            auto d = to_ms(now - blurry_since);
+            result.blurry_ms += d;
+            result.blurry_max_ms = std::max(result.blurry_max_ms, d);
+        }
+    };
+
+    // like the window, the document which fills most of its viewport is the active one
+    auto set_active = [&] {
+        PDFRenderer* active = nullptr;
+        float active_area = 0;
+        for (const auto& [doc, view] : views) {
+            auto area = renderers.at(doc)->get_visible_area(view.first);
+            if (area > active_area) {
+                active = renderers.at(doc).get();
+                active_area = area;
+            }
+        }
+        if (active != nullptr) {
+            active->set_active();
+        }
+    };
+
+    if (!chrome_trace.empty()) {
+        ChromeTrace::get_instance().start();
+    }
+
+    auto start = clock_type::now();
+    auto at = [&](double time_ms) {
+        return start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double, std::milli>(time_ms - events.front().time_ms));
+    };
+
+    size_t next = 0;
+    size_t seen_batches = 0;
+    while (next < events.size() or blurry) {
+        auto deadline = next < events.size() ? at(events.at(next).time_ms) : at(events.back().time_ms) + TAIL_TIMEOUT;
+
+        std::unique_lock<std::mutex> lock(batch_mutex);
+        bool batch = batch_condition.wait_until(lock, deadline, [&] { return amount_batches != seen_batches; });
+        seen_batches = amount_batches;
+        lock.unlock();
+
+        if (batch) {
+            for (const auto& [doc, view] : views) {
+                renderers.at(doc)->request(view.first, view.second);
+            }
+            update(clock_type::now());
+            continue;
+        }
+
+        if (next == events.size()) {
+            result.timed_out = true;
+            break;
+        }
+
+        const auto& e = events.at(next++);
+        auto r = renderers.find(e.document);
+        if (r == renderers.end()) {
+            continue;
+        }
+
+        result.max_lag_ms = std::max(result.max_lag_ms, to_ms(clock_type::now() - at(e.time_ms)));
+        if (e.type == PDFViewportTrace::Event::Type::POSITION) {
+            r->second->set_position(e.page, { e.view.x, e.view.y });
+        }
+        else {
+            views[e.document] = { e.view, e.dpi };
+            set_active();
+            r->second->request(e.view, e.dpi);
+        }
+        update(clock_type::now());
+    }
+
+    auto end = clock_type::now();
+    if (!chrome_trace.empty()) {
+        ChromeTrace::get_instance().stop();
+        ChromeTrace::get_instance().save(chrome_trace);
+    }
+    if (blurry) {
+        auto d = to_ms(end - blurry_since);
+        result.blurry_ms += d;
+        result.blurry_max_ms = std::max(result.blurry_max_ms, d);
+    }
+    result.duration_ms = to_ms(end - start);
+
+    for (const auto& s : processor->get_samples()) {
+        auto d = to_ms(s.finished - s.acquired);
+        if (s.cancelled) {
+            result.jobs_cancelled++;
+            result.cancelled_render_ms += d;
+            continue;
+        }
+
+        result.tiles_rendered++;
+        result.render_ms += d;
+        if (shown.contains(s.id)) {
+            result.tiles_shown++;
+        }
+        else {
+            result.unused_render_ms += d;
+        }
+    }
+
+    // the counters of the renderers themselves, summed over all documents
+    std::array<PDFRenderStatistics::JobCounters, PDFRenderStatistics::AMOUNT_JOB_KINDS> jobs = {};
+    size_t mip_builds = 0;
+    // how long the jobs of every document waited for a render thread
+    std::map<size_t, PDFRenderStatistics::Histogram::Snapshot> queue_waits;
+    for (const auto& [doc, r] : renderers) {
+        auto stats = r->stats();
+        mip_builds += stats.mip_builds;
+        queue_waits[doc] = stats.queue_wait_us;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            jobs.at(i).queued += stats.jobs.at(i).queued;
+            jobs.at(i).completed += stats.jobs.at(i).completed;
+            jobs.at(i).cancelled += stats.jobs.at(i).cancelled;
+            jobs.at(i).wasted += stats.jobs.at(i).wasted;
+        }
+    }
+    const std::array<const char*, PDFRenderStatistics::AMOUNT_JOB_KINDS> kind_names = { "content", "annotation", "widget", "preview", "display_list" };
+
+    auto total_work = result.render_ms + result.cancelled_render_ms;
+    auto wasted_fraction = total_work > 0 ? (result.unused_render_ms + result.cancelled_render_ms) / total_work : 0;
+
+    Logger::log("[Replay] ", trace_path.filename(), ": ", result.amount_events, " events in ", result.duration_ms, "ms",
+        result.timed_out ? " (timed out)" : "", ", max lag ", result.max_lag_ms, "ms");
+    Logger::log("[Replay]   blurry for ", result.blurry_ms, "ms in ", result.blurry_episodes, " episodes, longest ", result.blurry_max_ms, "ms");
+    Logger::log("[Replay]   ", result.tiles_rendered, " tiles rendered, ", result.tiles_rendered - result.tiles_shown, " never shown, ",
+        result.jobs_cancelled, " jobs cancelled, ", wasted_fraction * 100, "% of the render time wasted");
+    Logger::log("[Replay]   ", mip_builds, " tiles built from the finer level");
+    for (const auto& [doc, wait] : queue_waits) {
+        Logger::log("[Replay]   document ", doc, ": ", wait.count, " jobs waited p50/p95 ", wait.percentile(50) / 1000.0, "/",
+            wait.percentile(95) / 1000.0, "ms for a render thread");
+    }
+    for (size_t i = 0; i < jobs.size(); i++) {
+        Logger::log("[Replay]   ", kind_names.at(i), ": ", jobs.at(i).queued, " queued, ", jobs.at(i).completed, " completed, ",
+            jobs.at(i).cancelled, " cancelled, ", jobs.at(i).wasted, " wasted");
+    }
+
+    std::ofstream out(output);
+    if (!out) {
+        Logger::error("[Replay] Could not write to ", output);
+        return;
+    }
+
+    out << "{\n";
+    out << "  \"trace\": \"" << json_escape(reinterpret_cast<const char*>(trace_path.filename().u8string().c_str())) << "\",\n";
+    out << "  \"events\": " << result.amount_events << ",\n";
+    out << "  \"duration_ms\": " << result.duration_ms << ",\n";
+    out << "  \"max_lag_ms\": " << result.max_lag_ms << ",\n";
+    out << "  \"timed_out\": " << (result.timed_out ? "true" : "false") << ",\n";
+    out << "  \"blurry_ms\": " << result.blurry_ms << ",\n";
+    out << "  \"blurry_max_ms\": " << result.blurry_max_ms << ",\n";
+    out << "  \"blurry_episodes\": " << result.blurry_episodes << ",\n";
+    out << "  \"tiles_rendered\": " << result.tiles_rendered << ",\n";
+    out << "  \"tiles_shown\": " << result.tiles_shown << ",\n";
+    out << "  \"jobs_cancelled\": " << result.jobs_cancelled << ",\n";
+    out << "  \"render_ms\": " << result.render_ms << ",\n";
+    out << "  \"unused_render_ms\": " << result.unused_render_ms << ",\n";
+    out << "  \"cancelled_render_ms\": " << result.cancelled_render_ms << ",\n";
+    out << "  \"wasted_fraction\": " << wasted_fraction << ",\n";
+    out << "  \"mip_builds\": " << mip_builds << ",\n";
+    out << "  \"documents\": [\n";
+    for (auto it = queue_waits.begin(); it != queue_waits.end(); it++) {
+        const auto& wait = it->second;
+        out << "    { \"id\": " << it->first << ", \"jobs\": " << wait.count << ", \"queue_wait_us\": { \"p50\": " << wait.percentile(50)
+            << ", \"p95\": " << wait.percentile(95) << ", \"max\": " << wait.max << " } }" << (std::next(it) != queue_waits.end() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"jobs\": {\n";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const auto& j = jobs.at(i);
+        out << "    \"" << kind_names.at(i) << "\": { \"queued\": " << j.queued << ", \"completed\": " << j.completed
+            << ", \"cancelled\": " << j.cancelled << ", \"wasted\": " << j.wasted << " }" << (i + 1 < jobs.size() ? "," : "") << "\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
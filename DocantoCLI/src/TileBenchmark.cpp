@@ -0,0 +1,234 @@
+#include "Benchmarks.h"
+#include "HeadlessImageProcessor.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif // !NOMINMAX
+
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif // _WIN32
+
+using namespace Docanto;
+
+namespace {
+    typedef HeadlessImageProcessor::clock_type clock_type;
+
+    // the size of the window the viewport is shown in
+    constexpr float VIEW_WIDTH = 1280;
+    constexpr float VIEW_HEIGHT = 800;
+    constexpr auto RUN_TIMEOUT = std::chrono::seconds(60);
+
+    struct RunResult {
+        std::filesystem::path file;
+        size_t pages = 0;
+        float dpi = 0;
+        size_t threads = 0;
+
+        size_t tiles = 0;
+        size_t cancelled = 0;
+        // time from the first request until the tile was finished
+        std::vector<double> latency_ms;
+        // time the render thread spent on the tile
+        std::vector<double> render_ms;
+        double complete_ms = 0;
+        bool timed_out = false;
+        // the peak of the whole process so far, it never decreases between runs
+        size_t peak_rss = 0;
+    };
+
+    double to_ms(clock_type::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    // nearest rank percentile, the values have to be sorted
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+
+        auto rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted.at(std::clamp<size_t>(rank, 1, sorted.size()) - 1);
+    }
+
+    size_t get_peak_memory() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return counters.PeakWorkingSetSize;
+        }
+        return 0;
+#else
+        rusage usage = {};
+        getrusage(RUSAGE_SELF, &usage);
+        // linux reports kilobytes
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    RunResult run_viewport(const std::filesystem::path& file, float dpi, size_t threads) {
+        RunResult result;
+        result.file = file;
+        result.dpi = dpi;
+        result.threads = threads;
+
+        // the threads are only created again once no renderer exists
+        PDFRenderer::set_render_thread_count(threads);
+
+        std::mutex batch_mutex;
+        std::condition_variable batch_condition;
+        size_t amount_batches = 0;
+
+        auto processor = std::make_shared<HeadlessImageProcessor>();
+        auto notifier = std::make_shared<PDFRenderNotifier>([&](const PDFRenderNotifier::Batch&) {
+            {
+                std::scoped_lock<std::mutex> lock(batch_mutex);
+                amount_batches++;
+            }
+            batch_condition.notify_all();
+        });
+        notifier->set_flush_on_complete(true);
+
+        auto start = clock_type::now();
+        auto pdf = std::make_shared<PDF>(file);
+        result.pages = pdf->get_page_count();
+
+        PDFRenderer renderer(pdf, processor);
+        renderer.set_render_notifier(notifier);
+        // only the tiles of the viewport are measured
+        renderer.set_preview_budget(0);
+        renderer.set_prefetch_budget(0);
+
+        // the same viewport a window of that size shows at this dpi
+        Geometry::Rectangle<float> view = { 0, 0, VIEW_WIDTH * 96 / dpi, VIEW_HEIGHT * 96 / dpi };
+        renderer.request(view, dpi);
+
+        size_t seen_batches = 0;
+        while (!notifier->is_complete()) {
+            std::unique_lock<std::mutex> lock(batch_mutex);
+            if (!batch_condition.wait_until(lock, start + RUN_TIMEOUT, [&] { return amount_batches != seen_batches; })) {
+                result.timed_out = true;
+                break;
+            }
+            seen_batches = amount_batches;
+            lock.unlock();
+
+            // the host repaints after every batch, which requests the viewport again
+            renderer.request(view, dpi);
+        }
+
+        auto last = start;
+        for (const auto& s : processor->get_samples()) {
+            if (s.cancelled) {
+                result.cancelled++;
+                continue;
+            }
+
+            result.latency_ms.push_back(to_ms(s.finished - start));
+            result.render_ms.push_back(to_ms(s.finished - s.acquired));
+            last = std::max(last, s.finished);
+        }
+        std::sort(result.latency_ms.begin(), result.latency_ms.end());
+        std::sort(result.render_ms.begin(), result.render_ms.end());
+
+        result.tiles = result.latency_ms.size();
+        result.complete_ms = to_ms((result.timed_out ? clock_type::now() : last) - start);
+        result.peak_rss = get_peak_memory();
+
+        return result;
+    }
+
+    void write_json(const std::filesystem::path& output, const std::vector<RunResult>& results) {
+        std::ofstream out(output);
+        if (!out) {
+            Logger::error("[Tiles] Could not write to ", output);
+            return;
+        }
+
+        out << "{\n  \"view\": { \"width\": " << VIEW_WIDTH << ", \"height\": " << VIEW_HEIGHT << " },\n";
+        out << "  \"runs\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& r = results.at(i);
+            double seconds = r.complete_ms / 1000.0;
+
+            out << "    {\n";
+            out << "      \"file\": \"" << json_escape(reinterpret_cast<const char*>(r.file.filename().u8string().c_str())) << "\",\n";
+            out << "      \"pages\": " << r.pages << ",\n";
+            out << "      \"dpi\": " << r.dpi << ",\n";
+            out << "      \"threads\": " << r.threads << ",\n";
+            out << "      \"tiles\": " << r.tiles << ",\n";
+            out << "      \"cancelled\": " << r.cancelled << ",\n";
+            out << "      \"timed_out\": " << (r.timed_out ? "true" : "false") << ",\n";
+            out << "      \"viewport_complete_ms\": " << r.complete_ms << ",\n";
+            out << "      \"tiles_per_second\": " << (seconds > 0 ? r.tiles / seconds : 0) << ",\n";
+            out << "      \"latency_ms\": { \"p50\": " << percentile(r.latency_ms, 50) << ", \"p95\": " << percentile(r.latency_ms, 95)
+                << ", \"p99\": " << percentile(r.latency_ms, 99) << " },\n";
+            out << "      \"render_ms\": { \"p50\": " << percentile(r.render_ms, 50) << ", \"p95\": " << percentile(r.render_ms, 95)
+                << ", \"p99\": " << percentile(r.render_ms, 99) << " },\n";
+            out << "      \"peak_rss_bytes\": " << r.peak_rss << "\n";
+            out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+}
+
+std::string json_escape(const std::string& s) {
+    std::ostringstream out;
+    for (unsigned char c : s) {
+        switch (c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+            }
+            else {
+                out << c;
+            }
+        }
+    }
+    return out.str();
+}
+
+void benchmark_tiles(const std::filesystem::path& p, const std::filesystem::path& output) {
+    if (!std::filesystem::exists(p)) {
+        Logger::error("[Tiles] Could not find ", p);
+        return;
+    }
+
+    std::vector<float> dpis = { 96, 192, 384 };
+    std::vector<RunResult> results;
+
+    for (const auto& file : collect_pdfs(p)) {
+        for (auto dpi : dpis) {
+            for (auto threads : get_thread_counts()) {
+                auto r = run_viewport(file, dpi, threads);
+                // every run starts with an empty pool
+                BufferPool::get_instance().trim();
+
+                Logger::log("[Tiles] ", file.filename(), " at ", dpi, "dpi with ", threads, " threads: ", r.tiles, " tiles, complete after ",
+                    r.complete_ms, "ms", r.timed_out ? " (timed out)" : "");
+                Logger::log("[Tiles]   latency p50/p95/p99: ", percentile(r.latency_ms, 50), "/", percentile(r.latency_ms, 95), "/",
+                    percentile(r.latency_ms, 99), "ms, peak rss ", r.peak_rss / (1024 * 1024), "MiB");
+
+                results.push_back(std::move(r));
+            }
+        }
+    }
+
+    // the thread count is shared by all renderers, so it is set back for everything after the benchmark
+    PDFRenderer::set_render_thread_count();
+
+    write_json(output, results);
+    Logger::log("[Tiles] Wrote ", results.size(), " runs to ", output);
+}
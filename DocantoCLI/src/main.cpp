@@ -1,4 +1,5 @@
 #include "DocantoLib.h"
+#include "Benchmarks.h"
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -132,8 +133,7 @@ void test_write_write_conflict(ReadWriteThreadSafeMutex<int>& data) {
     writer2.join();
 }
 
-int main() {
-    Logger::init(&std::wcout);
+int run_mutex_tests() {
     ReadWriteThreadSafeMutex<int> shared_data(0);
 
     Logger::log("=== Concurrent Readers ===");
@@ -208,4 +208,42 @@ int main() {
     Logger::log("[Final Value] ", *final);
 
     return 0;
+}
+
+int main(int argc, char** argv) {
+    Logger::init(&std::wcout);
+    ChromeTrace::get_instance().set_thread_name("Main");
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // DocantoCLI bench-culling [pdf file or directory] [json output]
+    if (!args.empty() and args[0] == "bench-culling") {
+        benchmark_culling(args.size() > 1 ? args[1] : "pdf_tests", args.size() > 2 ? args[2] : "culling_benchmark.json");
+        return 0;
+    }
+
+    // DocantoCLI bench-lists [pdf file or directory]
+    if (!args.empty() and args[0] == "bench-lists") {
+        benchmark_display_lists(args.size() > 1 ? args[1] : "pdf_tests");
+        return 0;
+    }
+
+    // DocantoCLI bench-tiles [pdf file or directory] [json output]
+    if (!args.empty() and args[0] == "bench-tiles") {
+        benchmark_tiles(args.size() > 1 ? args[1] : "pdf_tests", args.size() > 2 ? args[2] : "tile_benchmark.json");
+        return 0;
+    }
+
+    // DocantoCLI bench-replay <trace file> [json output] [chrome trace output]
+    if (args.size() > 1 and args[0] == "bench-replay") {
+        benchmark_replay(args[1], args.size() > 2 ? args[2] : "replay_benchmark.json", args.size() > 3 ? args[3] : "");
+        return 0;
+    }
+
+    // DocantoCLI bench-mutex [json output]
+    if (!args.empty() and args[0] == "bench-mutex") {
+        benchmark_mutex(args.size() > 1 ? args[1] : "mutex_benchmark.json");
+        return 0;
+    }
+
+    return run_mutex_tests();
 }
\ No newline at end of file
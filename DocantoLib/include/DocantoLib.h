@@ -3,14 +3,24 @@
 #include "general/Logger.h"
 #include "general/Timer.h"
 #include "general/File.h"
+#include "general/MappedFile.h"
+#include "general/DiskStore.h"
+#include "general/BufferPool.h"
 #include "general/MathHelper.h"
 #include "general/ReadWriteMutex.h"
 #include "general/BasicRender.h"
 #include "general/ThreadSafeWrapper.h"
 
 #include "general/Common.h"
+#include "general/ChromeTrace.h"
+#include "general/SharedMutex.h"
 
 #include "pdf/PDF.h"
 #include "pdf/PDFContext.h"
 #include "pdf/PDFRenderer.h"
-#include "pdf/PDFAnnotation.h"
\ No newline at end of file
+#include "pdf/PDFAnnotation.h"
+#include "pdf/PDFTileCache.h"
+#include "pdf/PDFDiskTileCache.h"
+#include "pdf/PDFRenderNotifier.h"
+#include "pdf/PDFViewportTrace.h"
+#include "pdf/PDFRenderStatistics.h"
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#include "Common.h"
+
+namespace Docanto {
+	class BufferPool;
+
+	struct BufferDeleter {
+		// the pool the buffer goes back to, nullptr if it was allocated with new[]
+		BufferPool* pool = nullptr;
+		size_t capacity = 0;
+		// the memory belongs to someone else and is not freed
+		bool borrowed = false;
+
+		void operator()(byte* p) const;
+	};
+
+	// A buffer which either came from new[] or from a BufferPool. It is freed or returned accordingly
+	typedef std::unique_ptr<byte[], BufferDeleter> ByteBuffer;
+
+	/// <summary>
+	/// Wraps memory which is owned by someone else. It has to outlive the returned buffer.
+	/// </summary>
+	inline ByteBuffer borrow_buffer(byte* p) {
+		return ByteBuffer(p, BufferDeleter{ nullptr, 0, true });
+	}
+
+	/// <summary>
+	/// Keeps the buffers of released images so the next image of a similar size does not have to allocate.
+	/// The sizes are rounded up to size classes which are at most a quarter apart, every buffer is aligned
+	/// to ALIGNMENT bytes. The pool can be used from any thread.
+	/// </summary>
+	class BufferPool {
+	public:
+		static constexpr size_t ALIGNMENT = 64;
+		static constexpr size_t DEFAULT_BUDGET = 128 * 1024 * 1024;
+
+		struct Statistics {
+			// buffers which were taken from the pool
+			size_t hits = 0;
+			// buffers which had to be allocated
+			size_t misses = 0;
+
+			size_t amount_idle = 0;
+			size_t idle_bytes = 0;
+			size_t budget = 0;
+		};
+
+		BufferPool(size_t budget = DEFAULT_BUDGET);
+		~BufferPool();
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool& operator=(const BufferPool&) = delete;
+
+		static BufferPool& get_instance();
+
+		/// <summary>
+		/// Takes a buffer of the size class of the given size from the pool, or allocates a new one
+		/// </summary>
+		/// <param name="bytes">The minimum amount of bytes</param>
+		/// <returns>The buffer, it goes back to the pool once it is destroyed</returns>
+		ByteBuffer acquire(size_t bytes);
+
+		/// <summary>
+		/// Sets the amount of memory the idle buffers may use. Released buffers which do not fit are freed.
+		/// </summary>
+		void set_budget(size_t bytes);
+		size_t get_budget() const;
+
+		/// <summary>
+		/// Frees all idle buffers
+		/// </summary>
+		void trim();
+
+		Statistics get_statistics() const;
+
+		/// <summary>
+		/// Rounds the size of a row up so every row of an image starts on an aligned address
+		/// </summary>
+		static size_t get_aligned_stride(size_t row_bytes);
+
+		/// <summary>
+		/// The amount of bytes a buffer of at least the given size really has
+		/// </summary>
+		static size_t get_size_class(size_t bytes);
+	private:
+		friend struct BufferDeleter;
+
+		void release(byte* p, size_t capacity);
+
+		static byte* allocate(size_t capacity);
+		static void free(byte* p);
+
+		std::map<size_t, std::vector<byte*>> m_idle;
+		mutable std::mutex m_mutex;
+
+		size_t m_budget = 0;
+		size_t m_idle_bytes = 0;
+		size_t m_hits = 0;
+		size_t m_misses = 0;
+	};
+}
+
+#endif // !_BUFFERPOOL_H_
@@ -0,0 +1,109 @@
+#ifndef _CHROMETRACE_H_
+#define _CHROMETRACE_H_
+
+#include "Common.h"
+#include "Timer.h"
+
+namespace Docanto {
+	/// <summary>
+	/// Collects spans of the render pipeline and writes them in the trace event format, which can be opened
+	/// with chrome://tracing or Perfetto. Every thread shows up as its own track under the name it was given.
+	/// While the recording is stopped a span only costs a relaxed atomic load.
+	/// </summary>
+	class ChromeTrace {
+	public:
+		struct Argument {
+			const char* key = nullptr;
+			double value = 0;
+		};
+
+		/// <summary>
+		/// Measures the time until it is destroyed. Nothing is recorded if the recording was not running
+		/// when the span was created.
+		/// </summary>
+		class Span {
+		public:
+			Span(const char* name, const char* category = "render");
+			~Span();
+
+			Span(const Span&) = delete;
+			Span& operator=(const Span&) = delete;
+
+			Span& arg(const char* key, double value);
+		private:
+			const char* m_name = nullptr;
+			const char* m_category = nullptr;
+			long long m_start = -1;
+			std::vector<Argument> m_args;
+		};
+
+		static ChromeTrace& get_instance();
+
+		ChromeTrace(const ChromeTrace&) = delete;
+		ChromeTrace& operator=(const ChromeTrace&) = delete;
+
+		/// <summary>
+		/// Removes all recorded events and starts recording
+		/// </summary>
+		void start();
+		void stop();
+
+		bool is_enabled() const {
+			return m_enabled.load(std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// The microseconds since the trace was created. All events share this clock
+		/// </summary>
+		long long now_us() const;
+
+		/// <summary>
+		/// Names the track of the calling thread
+		/// </summary>
+		void set_thread_name(const std::string& name);
+
+		/// <summary>
+		/// Adds a span of the calling thread
+		/// </summary>
+		void add_span(const char* name, const char* category, long long start_us, long long end_us, std::vector<Argument> args = {});
+
+		/// <summary>
+		/// Adds a span which is not bound to the calling thread and may overlap other spans, like the time a job waited in a queue
+		/// </summary>
+		/// <param name="id">Identifies the span, it has to be unique among the spans with the same category</param>
+		void add_async_span(const char* name, const char* category, size_t id, long long start_us, long long end_us, std::vector<Argument> args = {});
+
+		/// <summary>
+		/// Writes all recorded events as a JSON file
+		/// </summary>
+		/// <returns>True if the file was written</returns>
+		bool save(const std::filesystem::path& p) const;
+
+		size_t get_amount_events() const;
+	private:
+		struct Event {
+			const char* name = nullptr;
+			const char* category = nullptr;
+			// X for a complete span, b and e for the begin and end of an async span
+			char phase = 'X';
+			size_t tid = 0;
+			long long ts = 0;
+			long long dur = 0;
+			size_t id = 0;
+			std::vector<Argument> args;
+		};
+
+		ChromeTrace() = default;
+
+		static size_t get_thread_index();
+
+		std::atomic_bool m_enabled = false;
+		Timer m_epoch;
+
+		std::vector<Event> m_events;
+		std::map<size_t, std::string> m_thread_names;
+		mutable std::mutex m_mutex;
+	};
+}
+
+#endif // !_CHROMETRACE_H_
@@ -2,8 +2,11 @@
 #define _COMMON_H_
 
 #include <string>
+#include <cstdint>
 #include <optional>
 #include <memory>
+#include <utility>
+#include <algorithm>
 
 #include <deque>
 #include <queue>
@@ -15,6 +18,8 @@
 #include <filesystem>
 #include <functional>
 
+#include <thread>
+#include <atomic>
 #include <mutex>
 #include <shared_mutex>
 #include <condition_variable>
@@ -0,0 +1,63 @@
+#include "Common.h"
+#include "MappedFile.h"
+
+#ifndef _DISKSTORE_H_
+#define _DISKSTORE_H_
+
+namespace Docanto {
+	/// <summary>
+	/// A directory of files which is kept within a byte budget. Once the budget is exceeded the least recently
+	/// used files are deleted. The order is kept across restarts through the last write time of the files.
+	/// </summary>
+	class DiskStore {
+	public:
+		/// <summary>
+		/// Opens the directory and indexes the files which are already stored. The directory will be created if needed.
+		/// </summary>
+		/// <param name="directory">The directory where the files are stored</param>
+		/// <param name="extension">Only files with this extension belong to the store</param>
+		/// <param name="budget">The amount of bytes the files may use on the disk</param>
+		DiskStore(const std::filesystem::path& directory, const std::filesystem::path& extension, size_t budget);
+		~DiskStore();
+
+		DiskStore(const DiskStore&) = delete;
+		DiskStore& operator=(const DiskStore&) = delete;
+
+		/// <summary>
+		/// Writes all parts one after another into the file. The file is only visible once it was completely written.
+		/// </summary>
+		/// <param name="name">The name of the file without the extension</param>
+		/// <returns>True if the file was written</returns>
+		bool store(const std::string& name, const std::vector<std::pair<const byte*, size_t>>& parts);
+
+		/// <summary>
+		/// Maps the file into memory and marks it as the most recently used one
+		/// </summary>
+		/// <param name="name">The name of the file without the extension</param>
+		/// <returns>The mapped file, if it exists</returns>
+		std::optional<MappedFile> load(const std::string& name);
+
+		bool contains(const std::string& name) const;
+		void remove(const std::string& name);
+
+		/// <summary>
+		/// Deletes all files of the store
+		/// </summary>
+		void clear();
+
+		void set_budget(size_t bytes);
+		size_t get_budget() const;
+
+		/// <summary>
+		/// The amount of bytes the files use on the disk
+		/// </summary>
+		size_t get_size() const;
+		size_t get_amount_files() const;
+	private:
+		struct impl;
+
+		std::unique_ptr<impl> pimpl;
+	};
+}
+
+#endif // !_DISKSTORE_H_
@@ -1,17 +1,18 @@
 #include "Common.h"
 #include "Logger.h"
+#include "BufferPool.h"
 
 #ifndef _FILE_H_
 #define _FILE_H_
 
 namespace Docanto {
 	struct File {
-		std::unique_ptr<byte> data = nullptr;
+		ByteBuffer data = nullptr;
 		std::filesystem::path path;
 		size_t size = 0;
 
 		File() = default;
-		File(std::unique_ptr<byte> data, size_t size) noexcept : data(std::move(data)), size(size) {}
+		File(ByteBuffer data, size_t size) noexcept : data(std::move(data)), size(size) {}
 
 		File(const File& other) = delete;
 		File& operator=(const File& other) = delete;
@@ -19,6 +20,19 @@ namespace Docanto {
 		File& operator=(File&& other) noexcept;
 		~File() = default;
 
+		/// <summary>
+		/// Calculates a 64 bit hash over the data. Files with the same content have the same hash,
+		/// no matter where they were loaded from. Unlike hash it reads the data in words of 8 bytes.
+		/// </summary>
+		/// <returns>The hash of the data</returns>
+		uint64_t get_content_hash() const;
+
+		/// <summary>
+		/// Calculates a 64 bit FNV-1a hash over the bytes
+		/// </summary>
+		/// <param name="seed">The hash of the previous bytes, to hash data which is not in one piece</param>
+		static uint64_t hash(const byte* data, size_t len, uint64_t seed = 0xcbf29ce484222325);
+
 		static std::optional<File> load(const std::filesystem::path& p);
 		static void write(const std::filesystem::path& p, const byte* data, size_t len);
 	};
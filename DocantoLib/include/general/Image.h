@@ -13,7 +13,7 @@ namespace Docanto {
 		size_t  dpi = 0;
 
 		Image() = default;
-		Image(std::unique_ptr<byte> data, size_t size, size_t width);
+		Image(ByteBuffer data, size_t size, size_t width);
 
 		Image(const Image&) = delete;
 		Image& operator=(const Image&) = delete;
@@ -21,6 +21,21 @@ namespace Docanto {
 		Image(Image&& other) noexcept;
 		Image& operator=(Image&& other) noexcept;
 	};
+
+	/// <summary>
+	/// Halves the width and height of an image with four components. Every pixel is the average of a block of
+	/// 2x2 pixels, an odd last row or column is dropped. The buffer of the result is taken from the BufferPool.
+	/// </summary>
+	/// <param name="swap_red_blue">Swaps the first and the third component, which turns BGRA into RGBA</param>
+	Image downsample_image(const Image& src, bool swap_red_blue = false);
+
+	/// <summary>
+	/// Copies the pixels of the source into the destination. Both need the same amount of components,
+	/// everything that does not fit into the destination is cut off.
+	/// </summary>
+	/// <param name="x">The column of the destination the left edge of the source is copied to</param>
+	/// <param name="y">The row of the destination the upper edge of the source is copied to</param>
+	void copy_image(const Image& src, Image& dst, size_t x, size_t y);
 }
 
 
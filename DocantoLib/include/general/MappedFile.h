@@ -0,0 +1,36 @@
+#include "Common.h"
+#include "Logger.h"
+
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+namespace Docanto {
+	/// <summary>
+	/// A read only view of a file which is mapped into memory. The pages are only read from the
+	/// disk once they are accessed and no intermediate buffer is needed.
+	/// </summary>
+	class MappedFile {
+		const byte* m_data = nullptr;
+		size_t m_size = 0;
+
+		// the handle of the file mapping, only used on windows
+		void* m_mapping = nullptr;
+
+		void unmap();
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile& operator=(const MappedFile& other) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		static std::optional<MappedFile> open(const std::filesystem::path& p);
+
+		const byte* data() const;
+		size_t size() const;
+	};
+}
+
+#endif // !_MAPPEDFILE_H_
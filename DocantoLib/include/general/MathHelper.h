@@ -1,6 +1,9 @@
 #ifndef _MATHHELPER_H_
 #define _MATHHELPER_H_
 
+#include <cmath>
+#include <algorithm>
+
 
 namespace Docanto {
 	namespace Geometry {
@@ -155,6 +158,7 @@ namespace Docanto {
 			Point<T> lowerleft() const { return { x, bottom() }; }
 			Point<T> lowerright() const { return { right(), bottom() }; }
 			Dimension<T> dims() const { return { width, height }; }
+			Point<T> center() const { return { x + width / 2, y + height / 2 }; }
 
 			template <typename W>
 			operator Rectangle<W>() const {
@@ -195,6 +199,35 @@ namespace Docanto {
 					   segement_intersects(p1, p2, ll, ul);
 			}
 
+			/// <summary>
+			/// Calculates the overlapping area of both rectangles
+			/// </summary>
+			/// <returns>The overlap or an empty rectangle if they dont intersect</returns>
+			Rectangle<T> intersection(const Rectangle<T>& other) const {
+				T left   = std::max(x, other.x);
+				T top    = std::max(y, other.y);
+				T r      = std::min(right(), other.right());
+				T b      = std::min(bottom(), other.bottom());
+
+				if (r <= left or b <= top) {
+					return Rectangle<T>(left, top, 0, 0);
+				}
+
+				return Rectangle<T>(left, top, r - left, b - top);
+			}
+
+			/// <summary>
+			/// Calculates the smallest rectangle which contains both rectangles
+			/// </summary>
+			Rectangle<T> merge(const Rectangle<T>& other) const {
+				T left   = std::min(x, other.x);
+				T top    = std::min(y, other.y);
+				T r      = std::max(right(), other.right());
+				T b      = std::max(bottom(), other.bottom());
+
+				return Rectangle<T>(left, top, r - left, b - top);
+			}
+
 			/// <summary>
 			/// Checks if the width and height are positive. If not it will change x,y,width and height to make it positive
 			/// </summary>
@@ -0,0 +1,51 @@
+#ifndef _SHAREDMUTEX_H_
+#define _SHAREDMUTEX_H_
+
+#include "Common.h"
+
+#include <array>
+
+namespace Docanto {
+	/// <summary>
+	/// A reader writer lock which a thread can lock again while it already holds it. A thread that holds the write
+	/// lock can also read, and a thread which is the only reader can upgrade to the write lock. Once a writer waits
+	/// no new reader gets the lock, only the threads which already read can lock again.
+	/// 
+	/// The readers are counted in multiple slots on their own cache lines and the locks a thread holds are kept in a
+	/// thread local list, so a read lock without a writer only costs one atomic increment on a slot few other
+	/// threads use.
+	/// </summary>
+	class ReentrantSharedMutex {
+	public:
+		static constexpr size_t AMOUNT_SLOTS = 16;
+
+		ReentrantSharedMutex() = default;
+
+		ReentrantSharedMutex(const ReentrantSharedMutex&) = delete;
+		ReentrantSharedMutex& operator=(const ReentrantSharedMutex&) = delete;
+
+		void lock();
+		void unlock();
+
+		void lock_shared();
+		void unlock_shared();
+	private:
+		struct alignas(64) ReaderSlot {
+			std::atomic<uint32_t> readers = 0;
+		};
+
+		std::array<ReaderSlot, AMOUNT_SLOTS> m_slots;
+
+		// only one thread at a time can hold or wait for the write lock
+		std::mutex m_writer_mutex;
+		// set while a writer holds or waits for the lock
+		alignas(64) std::atomic<uint32_t> m_writer = 0;
+		// increased by the readers which leave while a writer waits
+		std::atomic<uint32_t> m_release_signal = 0;
+
+		uint32_t count_readers() const;
+		void signal_release();
+	};
+}
+
+#endif // !_SHAREDMUTEX_H_
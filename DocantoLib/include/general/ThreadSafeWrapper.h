@@ -42,7 +42,7 @@ namespace Docanto {
 		ThreadSafeWrapper& operator=(ThreadSafeWrapper&&) noexcept = delete;
 
 
-		template<typename T, typename _mutex_type>
+		template<typename U, typename _other_mutex_type>
 		friend class ThreadSafeObj;
 	};
 
@@ -71,7 +71,7 @@ namespace Docanto {
 		T& operator*() const { return (ref->obj); }
 
 
-		template<typename T, typename _mutex_type>
+		template<typename U, typename _other_mutex_type>
 		friend class ThreadSafeWrapper;
 	};
 }
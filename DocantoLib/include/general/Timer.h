@@ -30,8 +30,9 @@ namespace Docanto {
     private:
         std::shared_ptr<Timer_impl> time;
 	};
-}
 
-std::wostream& operator<<(std::wostream& os, const Docanto::Timer& timer);
+	// declared next to the Timer so it is found by argument dependent lookup inside of the Logger templates
+	std::wostream& operator<<(std::wostream& os, const Timer& timer);
+}
 
 #endif // _TIMER_H_
\ No newline at end of file
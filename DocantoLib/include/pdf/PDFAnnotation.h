@@ -48,6 +48,12 @@ namespace Docanto {
 		std::vector<std::shared_ptr<AnnotationInfo>> get_annotation(size_t page, Geometry::Rectangle<float> rec);
 		void remove_annotation(std::shared_ptr<AnnotationInfo>);
 
+		/// <summary>
+		/// Returns the areas of the page which were changed by adding or removing annotations since the last call
+		/// </summary>
+		/// <returns>The areas in local doc space</returns>
+		std::vector<Geometry::Rectangle<float>> take_changed_areas(size_t page);
+
 	private:
 		struct impl;
 
@@ -0,0 +1,80 @@
+#ifndef _DOCANTO_PDFDISKTILECACHE_H_
+#define _DOCANTO_PDFDISKTILECACHE_H_
+
+#include "general/Common.h"
+#include "general/Image.h"
+
+namespace Docanto {
+	/// <summary>
+	/// Stores rendered tiles on the disk so they survive closing the document. The tiles are keyed by the
+	/// content hash of the file, which means a document that was opened before can show its tiles right
+	/// away. Every tile is one file in the cache directory, the directory is kept within a byte budget by
+	/// deleting the least recently used tiles. The cache can be shared by multiple PDFRenderer.
+	/// </summary>
+	class PDFDiskTileCache {
+	public:
+		struct TileKey {
+			// the content hash of the file (see File::get_content_hash)
+			uint64_t content_hash = 0;
+			size_t page = 0;
+			size_t zoom = 0;
+			size_t level = 0;
+			size_t x = 0;
+			size_t y = 0;
+
+			bool operator==(const TileKey& other) const = default;
+		};
+
+		static constexpr size_t DEFAULT_BUDGET = 1024 * 1024 * 1024;
+
+		/// <summary>
+		/// Opens the cache directory and indexes the tiles which are already stored. The directory will be created if needed.
+		/// </summary>
+		/// <param name="directory">The directory where the tiles are stored</param>
+		/// <param name="budget">The amount of bytes the tiles may use on the disk</param>
+		PDFDiskTileCache(const std::filesystem::path& directory = get_default_directory(), size_t budget = DEFAULT_BUDGET);
+		~PDFDiskTileCache();
+
+		PDFDiskTileCache(const PDFDiskTileCache&) = delete;
+		PDFDiskTileCache& operator=(const PDFDiskTileCache&) = delete;
+
+		/// <summary>
+		/// Writes the tile to the disk. If the budget is exceeded the least recently used tiles are deleted.
+		/// </summary>
+		/// <returns>True if the tile was written</returns>
+		bool store(const TileKey& key, const Image& img);
+
+		/// <summary>
+		/// Reads the tile by mapping its file into memory and marks it as the most recently used one.
+		/// The pixels are copied out of the mapping into a pooled buffer
+		/// </summary>
+		/// <returns>The image if the tile was found and is valid</returns>
+		std::optional<Image> load(const TileKey& key);
+
+		bool contains(const TileKey& key) const;
+
+		/// <summary>
+		/// Deletes all tiles of the directory
+		/// </summary>
+		void clear();
+
+		void set_budget(size_t bytes);
+		size_t get_budget() const;
+
+		/// <summary>
+		/// The amount of bytes the tiles use on the disk
+		/// </summary>
+		size_t get_size() const;
+
+		/// <summary>
+		/// The directory inside the temp directory of the system
+		/// </summary>
+		static std::filesystem::path get_default_directory();
+	private:
+		struct impl;
+
+		std::unique_ptr<impl> pimpl;
+	};
+}
+
+#endif // !_DOCANTO_PDFDISKTILECACHE_H_
@@ -0,0 +1,76 @@
+#ifndef _DOCANTO_PDFRENDERNOTIFIER_H_
+#define _DOCANTO_PDFRENDERNOTIFIER_H_
+
+#include "general/Common.h"
+#include "general/MathHelper.h"
+
+namespace Docanto {
+	/// <summary>
+	/// Collects the tiles finished by one or more PDFRenderer and reports them in batches, at most once per
+	/// interval. The callback is called from a thread owned by the notifier, never while a renderer is locked.
+	/// </summary>
+	class PDFRenderNotifier {
+	public:
+		struct Batch {
+			// the ids of the images which were finished since the last notification. 0 if display lists were built
+			std::vector<size_t> ids;
+			// the area covered by the new images in document coordinates
+			Geometry::Rectangle<float> dirty;
+			// if every renderer has finished all tiles of its viewport
+			bool complete = false;
+		};
+
+		static constexpr float DEFAULT_INTERVAL_MS = 16.0f;
+
+		PDFRenderNotifier(std::function<void(const Batch&)> callback, float interval_ms = DEFAULT_INTERVAL_MS);
+		~PDFRenderNotifier();
+
+		PDFRenderNotifier(const PDFRenderNotifier&) = delete;
+		PDFRenderNotifier& operator=(const PDFRenderNotifier&) = delete;
+
+		/// <summary>
+		/// Sets the minimum time between two notifications
+		/// </summary>
+		void set_interval(float ms);
+		float get_interval() const;
+
+		/// <summary>
+		/// If set, the pending batch is sent right away once the last renderer finished its viewport,
+		/// without waiting for the interval to pass
+		/// </summary>
+		void set_flush_on_complete(bool b);
+
+		/// <summary>
+		/// Adds a finished image to the current batch
+		/// </summary>
+		/// <param name="source">The id of the renderer</param>
+		/// <param name="rec">The area of the image in document coordinates</param>
+		void add(size_t source, size_t image_id, const Geometry::Rectangle<float>& rec);
+
+		/// <summary>
+		/// Tells the notifier if the renderer still has tiles of its viewport queued
+		/// </summary>
+		void set_complete(size_t source, bool complete);
+
+		/// <summary>
+		/// Forgets about the renderer, it will not hold back completion anymore
+		/// </summary>
+		void remove_source(size_t source);
+
+		/// <summary>
+		/// Checks if every renderer has finished all tiles of its viewport
+		/// </summary>
+		bool is_complete() const;
+
+		/// <summary>
+		/// Sends the pending batch right away
+		/// </summary>
+		void flush();
+	private:
+		struct impl;
+
+		std::unique_ptr<impl> pimpl;
+	};
+}
+
+#endif // !_DOCANTO_PDFRENDERNOTIFIER_H_
@@ -0,0 +1,152 @@
+#ifndef _DOCANTO_PDFRENDERSTATISTICS_H_
+#define _DOCANTO_PDFRENDERSTATISTICS_H_
+
+#include "general/Common.h"
+#include "PDFTileCache.h"
+
+#include <array>
+
+namespace Docanto {
+	/// <summary>
+	/// The counters of one PDFRenderer. Every counter is a relaxed atomic, so the render threads can update
+	/// them without taking a lock. A consistent view is only given by the snapshot.
+	/// </summary>
+	class PDFRenderStatistics {
+	public:
+		enum class JobKind {
+			CONTENT,
+			ANNOTATION,
+			WIDGET,
+			PREVIEW,
+			DISPLAY_LIST,
+			AMOUNT
+		};
+
+		static constexpr size_t AMOUNT_JOB_KINDS = static_cast<size_t>(JobKind::AMOUNT);
+
+		/// <summary>
+		/// Counts values in buckets of powers of two. Bucket i holds the values in [2^(i-1), 2^i), bucket 0 only holds 0.
+		/// </summary>
+		class Histogram {
+		public:
+			static constexpr size_t AMOUNT_BUCKETS = 48;
+
+			struct Snapshot {
+				std::array<size_t, AMOUNT_BUCKETS> buckets = {};
+				size_t count = 0;
+				uint64_t sum = 0;
+				uint64_t max = 0;
+
+				double mean() const;
+
+				/// <summary>
+				/// Estimates the percentile from the buckets, the result is the upper bound of the bucket it falls into
+				/// </summary>
+				/// <param name="p">The percentile between 0 and 100</param>
+				uint64_t percentile(double p) const;
+			};
+
+			void add(uint64_t value);
+			Snapshot snapshot() const;
+
+			/// <summary>
+			/// The largest value which is counted in the bucket
+			/// </summary>
+			static uint64_t get_bucket_limit(size_t bucket);
+		private:
+			std::array<std::atomic<uint64_t>, AMOUNT_BUCKETS> m_buckets = {};
+			std::atomic<uint64_t> m_count = 0;
+			std::atomic<uint64_t> m_sum = 0;
+			std::atomic<uint64_t> m_max = 0;
+		};
+
+		struct JobCounters {
+			// the jobs which are waiting in a queue and the ones which are rendered right now
+			size_t queue_depth = 0;
+			size_t running = 0;
+
+			size_t queued = 0;
+			size_t completed = 0;
+			// aborted before or while they were rendered
+			size_t cancelled = 0;
+			// rendered completely, but the result was not needed anymore
+			size_t wasted = 0;
+		};
+
+		struct Snapshot {
+			std::array<JobCounters, AMOUNT_JOB_KINDS> jobs;
+
+			Histogram::Snapshot render_time_us;
+			Histogram::Snapshot list_build_time_us;
+			Histogram::Snapshot list_bytes;
+
+			// the memory of the tiles in the tile cache and of the previews
+			size_t tile_bytes = 0;
+			size_t preview_bytes = 0;
+			PDFTileCache::Statistics tile_cache;
+
+			size_t disk_hits = 0;
+			size_t disk_misses = 0;
+			size_t list_store_hits = 0;
+			size_t list_store_misses = 0;
+			// the tiles which were built out of the downsampled tiles of the finer level
+			size_t mip_builds = 0;
+
+			// how long the jobs waited in the render queue of the renderer until a render thread took them
+			Histogram::Snapshot queue_wait_us;
+			// the share of the render threads the renderer gets compared to the other renderers
+			float schedule_weight = 1;
+			bool active = false;
+
+			const JobCounters& get(JobKind kind) const;
+
+			double get_tile_cache_hit_rate() const;
+			double get_disk_hit_rate() const;
+			double get_list_store_hit_rate() const;
+		};
+
+		PDFRenderStatistics() = default;
+
+		PDFRenderStatistics(const PDFRenderStatistics&) = delete;
+		PDFRenderStatistics& operator=(const PDFRenderStatistics&) = delete;
+
+		void add_queued(JobKind kind, size_t amount = 1);
+		void add_completed(JobKind kind);
+		void add_cancelled(JobKind kind);
+		void add_wasted(JobKind kind);
+
+		void add_render_time(uint64_t us);
+		void add_list_build(uint64_t us, uint64_t bytes);
+
+		void add_disk_lookup(bool hit);
+		void add_list_store_lookup(bool hit);
+		void add_mip_build();
+
+		/// <summary>
+		/// Copies the counters. The queue depths, the scheduling and the memory usage are not counted here and have
+		/// to be filled in by the renderer.
+		/// </summary>
+		Snapshot snapshot() const;
+	private:
+		struct AtomicJobCounters {
+			std::atomic<uint64_t> queued = 0;
+			std::atomic<uint64_t> completed = 0;
+			std::atomic<uint64_t> cancelled = 0;
+			std::atomic<uint64_t> wasted = 0;
+		};
+
+		std::array<AtomicJobCounters, AMOUNT_JOB_KINDS> m_jobs;
+
+		Histogram m_render_time;
+		Histogram m_list_build_time;
+		Histogram m_list_bytes;
+
+		std::atomic<uint64_t> m_disk_hits = 0;
+		std::atomic<uint64_t> m_disk_misses = 0;
+		std::atomic<uint64_t> m_list_store_hits = 0;
+		std::atomic<uint64_t> m_list_store_misses = 0;
+		std::atomic<uint64_t> m_mip_builds = 0;
+	};
+}
+
+#endif // !_DOCANTO_PDFRENDERSTATISTICS_H_
@@ -6,15 +6,57 @@
 #include "../general/ReadWriteMutex.h"
 #include "../general/BasicRender.h"
 #include "PDF.h"
+#include "PDFTileCache.h"
+#include "PDFDiskTileCache.h"
+#include "PDFRenderNotifier.h"
+#include "PDFViewportTrace.h"
+#include "PDFRenderStatistics.h"
+#include "../general/DiskStore.h"
 
 
 namespace Docanto {
+	/// <summary>
+	/// A buffer owned by the IPDFRenderImageProcessor which a tile is rendered into. Every pixel has four components
+	/// with premultiplied alpha, the rows are stride bytes apart.
+	/// </summary>
+	struct ImageTarget {
+		enum class PixelFormat {
+			RGBA,
+			BGRA
+		};
+
+		byte* data = nullptr;
+		size_t stride = 0;
+		PixelFormat format = PixelFormat::RGBA;
+	};
+
 	class IPDFRenderImageProcessor {
 	public:
 		virtual ~IPDFRenderImageProcessor() = default;
 
+		/// <summary>
+		/// Called for every rendered tile. The pixels are only valid during the call, afterwards the buffer goes back to the BufferPool.
+		/// </summary>
 		virtual void processImage(size_t id, const Image& img) = 0;
 		virtual void deleteImage(size_t id) = 0;
+
+		/// <summary>
+		/// Asks for the buffer the tile is rendered into, so it does not have to be copied in processImage.
+		/// Called from the render threads. If nothing is returned the tile is handed to processImage instead.
+		/// </summary>
+		/// <param name="dims">The size of the tile in pixels. The stride of the target has to be at least 4 * width</param>
+		virtual std::optional<ImageTarget> acquireImage(size_t /*id*/, const Geometry::Dimension<size_t>& /*dims*/, size_t /*dpi*/) { return std::nullopt; }
+
+		/// <summary>
+		/// The tile was rendered into the acquired target. From now on it is treated like an image given to processImage
+		/// and will be removed with deleteImage.
+		/// </summary>
+		virtual void commitImage(size_t /*id*/) {}
+
+		/// <summary>
+		/// The tile was aborted or is not needed anymore. The acquired target can be reused.
+		/// </summary>
+		virtual void cancelImage(size_t /*id*/) {}
 	};
 
 	class PDFRenderer {
@@ -24,6 +66,17 @@ namespace Docanto {
 			float dpi = 0;
 
 			size_t page = 0;
+
+			// identifies the tile in the tile cache
+			PDFTileCache::TileKey key;
+		};
+
+		struct TileGrid {
+			// the key of the tile in the upper left corner
+			PDFTileCache::TileKey key;
+			Geometry::Dimension<float> cell;
+			size_t amount_cells = 1;
+			float dpi = 0;
 		};
 
 		std::shared_ptr<PDF> pdf_obj;
@@ -36,35 +89,193 @@ namespace Docanto {
 
 		// this function gets called when a bitmaps was processed
 		std::function<void(size_t)> m_render_callback;
+		// collects the processed bitmaps so the host is not notified for every single one
+		std::shared_ptr<PDFRenderNotifier> m_render_notifier;
+		// records every request so it can be replayed later
+		std::shared_ptr<PDFViewportTrace> m_viewport_trace;
 
 		float m_standard_dpi = 96;
 		float m_preview_dpi = MUPDF_DEFAULT_DPI;
 		float m_margin = 1;
+		// the amount of pages before and after the viewport whose display lists are built ahead of time
+		size_t m_list_prefetch_pages = 2;
+		// how many seconds of movement are prefetched ahead of the viewport
+		float m_prefetch_lookahead = 0.5f;
+		// the viewport has to move faster than this (in viewports per second) before anything is prefetched
+		float m_prefetch_min_speed = 0.25f;
+		// the zoom has to change faster than this (in doublings per second) before the next zoom level is prefetched
+		float m_prefetch_min_zoom_speed = 0.5f;
+		// the motion is reset if the viewport did not change for this many seconds
+		float m_prefetch_pause = 0.25f;
+		// how far (in doublings of the dpi) the zoom has to move past the bounds of the current level before the tiles
+		// of the next level are requested
+		float m_level_hysteresis = 0.2f;
+		// a tile which is estimated to take longer than this (in ms) is split into four tiles at the same dpi
+		float m_max_tile_cost = 50.0f;
+		// four tiles which together are estimated to take less than this (in ms) are merged into one
+		float m_min_tile_cost = 5.0f;
+		// how often a tile can be split
+		size_t m_max_split_depth = 2;
+		// merged tiles can not have more pixels than this
+		size_t m_max_merged_pixels = 2048 * 2048;
 
 		void remove_from_processor(size_t id);
 		void add_to_processor();
 
-		size_t remove_finished_queue_item();
-		size_t abort_queue_item(size_t page, float dpi);
-		size_t cull_bitmaps(ThreadSafeVector<PDFRenderInfo>& info, size_t page, float dpi);
-		size_t cull_chunks(std::vector<Geometry::Rectangle<float>>& chunks, size_t pagee, ThreadSafeVector<PDFRenderInfo>& info);
+		size_t cull_bitmaps(ThreadSafeVector<PDFRenderInfo>& info, size_t page, const TileGrid& grid);
+		size_t cull_chunks(std::vector<PDFRenderInfo>& chunks, size_t page);
+
+		/// <summary>
+		/// Takes all chunks which are still in the tile cache and adds them back to the bitmaps
+		/// </summary>
+		/// <returns>The amount of chunks which were found in the cache</returns>
+		size_t take_from_cache(std::vector<PDFRenderInfo>& chunks, ThreadSafeVector<PDFRenderInfo>& info);
+
+		/// <summary>
+		/// Queues a job to load every content chunk which is stored in the disk tile cache. The chunks are removed
+		/// so they are not rendered, the render threads read the files and add the tiles to the bitmaps.
+		/// </summary>
+		/// <returns>The amount of chunks which are loaded from the disk</returns>
+		size_t take_from_disk(std::vector<PDFRenderInfo>& chunks);
+
+		/// <summary>
+		/// Builds the chunks out of the downsampled tiles of the next finer level. The built tiles are drawn right away,
+		/// but only the ones which are sharp enough for the current dpi are removed from the chunks.
+		/// </summary>
+		/// <returns>The amount of tiles which were built</returns>
+		size_t take_from_mips(std::vector<PDFRenderInfo>& chunks, ThreadSafeVector<PDFRenderInfo>& info);
+
+		/// <summary>
+		/// Keeps the downsampled tile, so the tile of the next coarser level can be built from it
+		/// </summary>
+		/// <param name="mip">The tile at half its resolution in RGBA</param>
+		void store_mip(const PDFRenderInfo& info, Image&& mip);
 
+		/// <summary>
+		/// Stops drawing the bitmaps. If the tile cache still holds a bitmap it is only unpinned, else it will be deleted
+		/// </summary>
+		void release_bitmaps(const std::vector<PDFRenderInfo>& infos);
+
+		/// <summary>
+		/// Deletes the bitmaps which were evicted from the tile cache
+		/// </summary>
+		void evict_tiles();
+
+		/// <summary>
+		/// Queues a low resolution preview for every page which does not have one yet. The pages closest to the
+		/// viewport come first, the previews of pages which do not fit into the preview budget are removed.
+		/// </summary>
+		void request_previews();
+
+		/// <summary>
+		/// Tracks how the viewport moves between requests and queues the tiles and display lists in the direction
+		/// of travel. Prefetched tiles are only put into the tile cache and are drawn once they become visible.
+		/// All prefetch jobs are canceled as soon as the direction or the zoom trend changes.
+		/// </summary>
+		/// <param name="previous_view">The viewport of the last request</param>
+		/// <param name="previous_dpi">The dpi of the last request</param>
+		/// <param name="viewport_changed">If the viewport is different from the last request</param>
+		void request_prefetch(const Geometry::Rectangle<float>& previous_view, float previous_dpi, bool viewport_changed);
+
+		/// <summary>
+		/// Makes every queued job stale and aborts the ones which are currently rendered
+		/// </summary>
 		void abort_all_items();
 
 		void position_pdfs();
 
-		std::pair<std::vector<Geometry::Rectangle<float>>, float> get_chunks(size_t page);
-		float get_chunk_scale() const;
+		TileGrid get_tile_grid(size_t page, float dpi) const;
+
+		/// <summary>
+		/// Calculates the grid of the page which has 2^level tiles per axis
+		/// </summary>
+		TileGrid get_level_grid(size_t page, size_t level) const;
+
+		/// <summary>
+		/// Calculates the grid the viewport of the page is rendered at. The level of the last request is kept
+		/// until the zoom moved further than m_level_hysteresis past its bounds.
+		/// </summary>
+		TileGrid get_target_grid(size_t page, float dpi);
+
+		/// <summary>
+		/// Adds the render time of a tile to the costs of its page
+		/// </summary>
+		/// <param name="cost_us">The time rendering the whole tile takes, 0 if it is unknown</param>
+		/// <param name="pixels">The amount of pixels of the tile</param>
+		void record_cost(const PDFRenderInfo& info, uint64_t cost_us, size_t pixels);
+
+		/// <summary>
+		/// Estimates how long rendering the area takes from the measured costs. Areas which were never measured
+		/// are estimated from the amount of nodes in the display list of the page.
+		/// </summary>
+		/// <returns>The time in ms</returns>
+		float estimate_cost(size_t page, const Geometry::Rectangle<float>& rec, float dpi);
+
+		/// <summary>
+		/// Decides how the block of 2x2 cells which contains the cell is rendered. Expensive cells are split into
+		/// smaller tiles and cheap blocks are merged into one tile, both at the dpi of the grid. Once any tile
+		/// of a block was rendered its layout is kept.
+		/// </summary>
+		/// <param name="change_existing">If false only blocks without a layout get one, the existing layouts are kept</param>
+		void update_layout(size_t page, const TileGrid& grid, size_t x, size_t y, bool change_existing = true);
+
+		/// <summary>
+		/// The keys of the tiles the cell of the grid is rendered as
+		/// </summary>
+		std::vector<PDFTileCache::TileKey> get_layout_keys(size_t page, const TileGrid& grid, size_t x, size_t y) const;
+
+		/// <summary>
+		/// Checks if the tile is part of the layout of the grid
+		/// </summary>
+		bool is_layout_key(size_t page, const TileGrid& grid, const PDFTileCache::TileKey& key) const;
+
+		/// <summary>
+		/// Calculates the tiles of the page which intersect the given viewport
+		/// </summary>
+		/// <param name="view">The viewport in document space</param>
+		/// <param name="grid">The grid of the tiles</param>
+		/// <param name="change_layouts">If the layouts of the blocks may be changed. Only the viewport may do this,
+		/// since the jobs of a block which are still waiting are dropped once its layout changes</param>
+		std::vector<PDFRenderInfo> get_chunks(size_t page, const Geometry::Rectangle<float>& view, const TileGrid& grid, bool change_layouts = true);
+		float get_chunk_scale(float dpi) const;
+
+		/// <summary>
+		/// The size of the page compared to a page of 600x850, the tiles get smaller on larger pages
+		/// </summary>
+		float get_page_factor(size_t page) const;
+
+		/// <summary>
+		/// The dpi the tiles of the level are rendered at
+		/// </summary>
+		float get_level_dpi(size_t page, size_t level) const;
+
+		/// <summary>
+		/// Calculates the area of the page which is covered by the tile
+		/// </summary>
+		/// <param name="dims">The dimension of the page</param>
+		Geometry::Rectangle<float> get_tile_rec(const PDFTileCache::TileKey& key, const Geometry::Dimension<float>& dims) const;
 
 		void async_render(); 
-		void receive_image(PDFRenderInfo info, Image&& i);
+		void receive_image(PDFRenderInfo info, Image&& i, uint64_t render_us);
+		void load_from_disk(PDFRenderInfo info);
+
+		/// <summary>
+		/// Tells the render callback and the notifier that an image is ready
+		/// </summary>
+		/// <param name="rec">The area of the image in document coordinates</param>
+		void notify_rendered(size_t image_id, const Geometry::Rectangle<float>& rec);
+
+		/// <summary>
+		/// Tells the notifier if all tiles of the viewport are drawn
+		/// </summary>
+		void notify_completion();
 	public:
 		PDFRenderer(std::shared_ptr<PDF> pdf_obj, std::shared_ptr<IPDFRenderImageProcessor> processor);
 		~PDFRenderer();
 
 		Image get_image(size_t page, float dpi = MUPDF_DEFAULT_DPI);
 
-		const std::vector<PDFRenderInfo>& get_preview();
+		Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> get_preview();
 		Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> draw();
 		Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> annot();
 
@@ -96,22 +307,153 @@ namespace Docanto {
 		/// <returns></returns>
 		Geometry::Dimension<float> get_max_dimension();
 
+		/// <summary>
+		/// Calculates how much of the viewport is covered by the pages of this pdf
+		/// </summary>
+		/// <returns>The area of the pages inside of the viewport</returns>
+		float get_visible_area(const Geometry::Rectangle<float>& view) const;
+
 		void request(Geometry::Rectangle<float> view, float dpi);
 		void set_rendercallback(std::function<void(size_t)> fun);
+
+		/// <summary>
+		/// Reports the finished tiles to the notifier in batches. It can be shared by multiple renderers,
+		/// the render callback is still called for every tile.
+		/// </summary>
+		void set_render_notifier(std::shared_ptr<PDFRenderNotifier> notifier);
+
+		/// <summary>
+		/// Records every request and every change of a page position to the trace. The current positions
+		/// of all pages are recorded right away.
+		/// </summary>
+		/// <param name="trace">The trace, it may be shared with other renderers. nullptr stops the recording</param>
+		void set_viewport_trace(std::shared_ptr<PDFViewportTrace> trace);
 				
 		void debug_draw(std::shared_ptr<BasicRender> render);
 
+		/// <summary>
+		/// Builds the display lists of all pages on the calling thread. Usually this is not needed since
+		/// the lists are built by the render threads once the pages come close to the viewport.
+		/// </summary>
 		void update();
+
+		/// <summary>
+		/// Builds the display lists of all pages like update(), but records the page content on multiple threads.
+		/// Every thread uses its own context and its own document over the data of the file, the annotations
+		/// are still taken from the main document since they might have been changed.
+		/// </summary>
+		/// <param name="amount_threads">The amount of threads, 0 will use one per hardware thread</param>
+		void update_parallel(size_t amount_threads = 0);
+
+		/// <summary>
+		/// Records the annotation layer of the page again. Every annotation has its own display list, only the
+		/// ones of annotations which were added or changed since the last update are recorded.
+		/// </summary>
 		void update_page_annotations(size_t page);
 
+		/// <summary>
+		/// Checks if the display lists of the page were built. Until then the page can only be shown as a placeholder
+		/// </summary>
+		/// <param name="page">Number of the page</param>
+		/// <returns>True if the page can be rendered</returns>
+		bool is_page_ready(size_t page);
+
 		void reload();
 
 		void reload_annotations_page(size_t page);
+
+		/// <summary>
+		/// Rebuilds the annotations of the page and renders only the annotation tiles which intersect one of the
+		/// changed areas again. The old tiles are drawn until their replacements arrive.
+		/// </summary>
+		/// <param name="areas">The changed areas in the coordinates of the page</param>
+		void reload_annotations_page(size_t page, const std::vector<Geometry::Rectangle<float>>& areas);
+
+		/// <summary>
+		/// Sets the amount of memory the rendered tiles may use. Tiles that are not visible are kept
+		/// until this budget is exceeded and are then evicted in least recently used order.
+		/// </summary>
+		/// <param name="bytes">The budget in bytes</param>
+		void set_cache_budget(size_t bytes);
+		PDFTileCache::Statistics get_cache_statistics() const;
+
+		/// <summary>
+		/// Takes a snapshot of the counters of the render pipeline: the jobs of every kind, the render and
+		/// display list build times, the memory held by the tiles and the hit rates of the caches.
+		/// The counters only ever grow, rates have to be calculated from two snapshots.
+		/// </summary>
+		PDFRenderStatistics::Snapshot stats() const;
+
+		/// <summary>
+		/// Sets the amount of memory the page previews may use. This budget is separate from the tile cache.
+		/// </summary>
+		/// <param name="bytes">The budget in bytes</param>
+		void set_preview_budget(size_t bytes);
+
+		/// <summary>
+		/// Sets the amount of memory the downsampled tiles may use. Every rendered tile is kept at half its
+		/// resolution, so zooming out can build the tiles of the coarser level without rendering them.
+		/// </summary>
+		/// <param name="bytes">The budget in bytes, 0 disables it</param>
+		void set_mip_budget(size_t bytes);
+
+		/// <summary>
+		/// Sets the disk tile cache which is consulted before a tile is rendered. The rendered content tiles
+		/// are written to it, the annotations are always rendered since they can change at any time.
+		/// The document is hashed on a worker first, the cache is used once the hash is known.
+		/// </summary>
+		/// <param name="cache">The cache, it may be shared with other renderers. nullptr disables it</param>
+		void set_disk_cache(std::shared_ptr<PDFDiskTileCache> cache);
+
+		/// <summary>
+		/// Sets the store for the display lists of the page contents. Pages which were interpreted before are loaded
+		/// from it instead, which only works for pages that consist of paths. Everything else is still interpreted.
+		/// Like the disk cache it is used once the document is hashed.
+		/// </summary>
+		/// <param name="store">The store, it may be shared with other renderers. nullptr disables it</param>
+		void set_display_list_store(std::shared_ptr<DiskStore> store);
+
+		/// <summary>
+		/// Sets the amount of memory the tiles which are prefetched ahead of the moving viewport may use
+		/// </summary>
+		/// <param name="bytes">The budget in bytes, 0 disables prefetching</param>
+		void set_prefetch_budget(size_t bytes);
+
+		/// <summary>
+		/// Sets how far ahead of the moving viewport tiles are prefetched
+		/// </summary>
+		/// <param name="seconds">The amount of seconds the viewport needs to reach the prefetched tiles</param>
+		void set_prefetch_lookahead(float seconds);
+
+		/// <summary>
+		/// Sets the amount of render threads which are shared by all PDFRenderer. A value of 0 will use
+		/// one thread per hardware thread. The value is only applied when the threads are (re)created,
+		/// which happens once no PDFRenderer exists anymore.
+		/// </summary>
+		/// <param name="amount">Amount of render threads</param>
+		static void set_render_thread_count(size_t amount = 0);
+		static size_t get_render_thread_count();
+
+		/// <summary>
+		/// Marks this pdf as the one the user works with. All renderers share the render threads, each one
+		/// gets the same share of them except for the active one which gets a larger share.
+		/// Only one renderer can be active at a time.
+		/// </summary>
+		void set_active(bool active = true);
+		bool is_active() const;
+
+		/// <summary>
+		/// Sets how much render time the active renderer gets compared to each of the others
+		/// </summary>
+		/// <param name="boost">The factor, 1 treats all renderers the same</param>
+		static void set_active_boost(float boost);
 	private:
 		struct impl;
 		class RenderThreadManager;
 		static std::unique_ptr<RenderThreadManager> thread_manager;
 		static size_t tread_manager_count;
+		static size_t render_thread_count;
+		static std::atomic<float> active_boost;
 
 		std::unique_ptr<impl> pimpl;
 	};
@@ -0,0 +1,120 @@
+#ifndef _DOCANTO_PDFTILECACHE_H_
+#define _DOCANTO_PDFTILECACHE_H_
+
+#include "general/Common.h"
+
+namespace Docanto {
+	/// <summary>
+	/// Keeps track of all rendered tiles and the memory they use. Tiles which are currently drawn are
+	/// pinned, every other tile is kept until the byte budget is exceeded and is then evicted in least
+	/// recently used order. The cache does not hold the pixels itself, it only knows the id under which
+	/// the image was handed to the IPDFRenderImageProcessor.
+	/// </summary>
+	class PDFTileCache {
+	public:
+		struct TileKey {
+			// the id of the document (the PDFRenderer)
+			size_t document = 0;
+			size_t page = 0;
+			// the dpi the tile was rendered at
+			size_t zoom = 0;
+			// log2 of the amount of tiles per axis
+			size_t level = 0;
+			size_t x = 0;
+			size_t y = 0;
+			// content or annotation
+			size_t layer = 0;
+
+			bool operator==(const TileKey& other) const = default;
+		};
+
+		struct TileKeyHash {
+			size_t operator()(const TileKey& k) const;
+		};
+
+		struct Statistics {
+			size_t hits = 0;
+			size_t misses = 0;
+			size_t evictions = 0;
+
+			size_t amount_tiles = 0;
+			size_t amount_pinned = 0;
+			size_t bytes = 0;
+			// the bytes of the tiles which were inserted unpinned and were not looked up since
+			size_t prefetched_bytes = 0;
+			size_t budget = 0;
+		};
+
+		static constexpr size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+		PDFTileCache(size_t budget = DEFAULT_BUDGET);
+		~PDFTileCache();
+
+		PDFTileCache(const PDFTileCache&) = delete;
+		PDFTileCache& operator=(const PDFTileCache&) = delete;
+
+		void set_budget(size_t bytes);
+		size_t get_budget() const;
+
+		/// <summary>
+		/// Adds a new tile. If there was already a tile with the same key it will be replaced.
+		/// </summary>
+		/// <param name="pin">If the tile should be pinned. Tiles which are not drawn yet can be evicted right away
+		/// and count as prefetched until they are looked up with a pin</param>
+		/// <returns>The image id of the replaced tile, if there was one</returns>
+		std::optional<size_t> insert(const TileKey& key, size_t image_id, size_t bytes, bool pin = true);
+
+		/// <summary>
+		/// Looks for a tile and marks it as the most recently used one. The lookup is counted as a hit or miss.
+		/// </summary>
+		/// <param name="pin">If the tile should be pinned</param>
+		/// <returns>The image id of the tile if it was found</returns>
+		std::optional<size_t> lookup(const TileKey& key, bool pin = true);
+
+		bool contains(const TileKey& key) const;
+
+		/// <summary>
+		/// Unpins the tile so it can be evicted
+		/// </summary>
+		/// <param name="image_id">The id of the image which was drawn for this key</param>
+		/// <returns>False if the cache does not hold this image under the given key</returns>
+		bool unpin(const TileKey& key, size_t image_id);
+
+		/// <summary>
+		/// Removes the tile from the cache
+		/// </summary>
+		/// <returns>The image id of the removed tile</returns>
+		std::optional<size_t> remove(const TileKey& key);
+
+		/// <summary>
+		/// Removes all tiles for which the predicate returns true, regardless of them being pinned
+		/// </summary>
+		/// <returns>The image ids of the removed tiles</returns>
+		std::vector<size_t> remove_if(std::function<bool(const TileKey&)> pred);
+
+		/// <summary>
+		/// Evicts the least recently used unpinned tiles until the cache is within its budget
+		/// </summary>
+		/// <returns>The image ids of the evicted tiles</returns>
+		std::vector<size_t> evict();
+
+		/// <summary>
+		/// Removes all tiles
+		/// </summary>
+		/// <returns>The image ids of all tiles</returns>
+		std::vector<size_t> clear();
+
+		Statistics get_statistics() const;
+
+		/// <summary>
+		/// The same as Statistics::prefetched_bytes, without counting the pinned tiles
+		/// </summary>
+		size_t get_prefetched_bytes() const;
+	private:
+		struct impl;
+
+		std::unique_ptr<impl> pimpl;
+	};
+}
+
+#endif // !_DOCANTO_PDFTILECACHE_H_
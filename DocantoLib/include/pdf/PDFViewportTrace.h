@@ -0,0 +1,77 @@
+#ifndef _DOCANTO_PDFVIEWPORTTRACE_H_
+#define _DOCANTO_PDFVIEWPORTTRACE_H_
+
+#include "general/Common.h"
+#include "general/MathHelper.h"
+
+namespace Docanto {
+	/// <summary>
+	/// Records every viewport requested from one or more PDFRenderer together with the time it was requested,
+	/// so real scroll and zoom sequences can be replayed later. The positions of the pages are recorded as well
+	/// since the viewport is meaningless without them.
+	/// </summary>
+	class PDFViewportTrace {
+	public:
+		struct Document {
+			// the id of the renderer
+			size_t id = 0;
+			std::filesystem::path path;
+		};
+
+		struct Event {
+			enum class Type {
+				REQUEST,
+				POSITION
+			};
+
+			Type type = Type::REQUEST;
+			// the milliseconds since the recording started
+			double time_ms = 0;
+			size_t document = 0;
+
+			// the requested viewport, for a position only x and y are used
+			Geometry::Rectangle<float> view;
+			float dpi = 0;
+			size_t page = 0;
+		};
+
+		PDFViewportTrace();
+		~PDFViewportTrace();
+
+		PDFViewportTrace(const PDFViewportTrace&) = delete;
+		PDFViewportTrace& operator=(const PDFViewportTrace&) = delete;
+
+		/// <summary>
+		/// Remembers which file the renderer shows. If the document is already known nothing happens.
+		/// </summary>
+		void add_document(size_t id, const std::filesystem::path& path);
+
+		void record_request(size_t document, const Geometry::Rectangle<float>& view, float dpi);
+		void record_position(size_t document, size_t page, const Geometry::Point<float>& pos);
+
+		std::vector<Document> get_documents() const;
+
+		/// <summary>
+		/// Returns all events in the order they were recorded
+		/// </summary>
+		std::vector<Event> get_events() const;
+
+		/// <summary>
+		/// Writes the trace as a text file with one event per line
+		/// </summary>
+		/// <returns>True if the file was written</returns>
+		bool save(const std::filesystem::path& p) const;
+
+		/// <summary>
+		/// Reads a trace which was written with save()
+		/// </summary>
+		/// <returns>The trace or nullptr if the file could not be read</returns>
+		static std::shared_ptr<PDFViewportTrace> load(const std::filesystem::path& p);
+	private:
+		struct impl;
+
+		std::unique_ptr<impl> pimpl;
+	};
+}
+
+#endif // !_DOCANTO_PDFVIEWPORTTRACE_H_
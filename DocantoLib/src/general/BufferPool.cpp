@@ -0,0 +1,145 @@
+#include "BufferPool.h"
+
+#include <bit>
+#include <new>
+
+void Docanto::BufferDeleter::operator()(byte* p) const {
+	if (p == nullptr or borrowed) {
+		return;
+	}
+
+	if (pool == nullptr) {
+		delete[] p;
+		return;
+	}
+
+	pool->release(p, capacity);
+}
+
+Docanto::BufferPool::BufferPool(size_t budget) {
+	m_budget = budget;
+}
+
+Docanto::BufferPool::~BufferPool() {
+	trim();
+}
+
+Docanto::BufferPool& Docanto::BufferPool::get_instance() {
+	static BufferPool instance;
+	return instance;
+}
+
+byte* Docanto::BufferPool::allocate(size_t capacity) {
+	return static_cast<byte*>(::operator new(capacity, std::align_val_t(ALIGNMENT)));
+}
+
+void Docanto::BufferPool::free(byte* p) {
+	::operator delete(p, std::align_val_t(ALIGNMENT));
+}
+
+size_t Docanto::BufferPool::get_aligned_stride(size_t row_bytes) {
+	return (row_bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+size_t Docanto::BufferPool::get_size_class(size_t bytes) {
+	bytes = std::max(bytes, ALIGNMENT);
+
+	// four classes between two powers of two, so at most a quarter of a buffer is wasted
+	size_t step = std::max<size_t>(std::bit_floor(bytes) / 4, ALIGNMENT);
+	return (bytes + step - 1) / step * step;
+}
+
+Docanto::ByteBuffer Docanto::BufferPool::acquire(size_t bytes) {
+	auto capacity = get_size_class(bytes);
+	byte* p = nullptr;
+
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		auto it = m_idle.find(capacity);
+		if (it != m_idle.end() and !it->second.empty()) {
+			p = it->second.back();
+			it->second.pop_back();
+			m_idle_bytes -= capacity;
+			m_hits++;
+		}
+		else {
+			m_misses++;
+		}
+	}
+
+	// the allocation is done without holding the lock
+	if (p == nullptr) {
+		p = allocate(capacity);
+	}
+
+	return ByteBuffer(p, BufferDeleter{ this, capacity });
+}
+
+void Docanto::BufferPool::release(byte* p, size_t capacity) {
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		if (m_idle_bytes + capacity <= m_budget) {
+			m_idle[capacity].push_back(p);
+			m_idle_bytes += capacity;
+			return;
+		}
+	}
+
+	free(p);
+}
+
+void Docanto::BufferPool::set_budget(size_t bytes) {
+	std::vector<byte*> to_free;
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		m_budget = bytes;
+
+		// the largest buffers are freed first
+		for (auto it = m_idle.rbegin(); it != m_idle.rend() and m_idle_bytes > m_budget; it++) {
+			while (!it->second.empty() and m_idle_bytes > m_budget) {
+				to_free.push_back(it->second.back());
+				it->second.pop_back();
+				m_idle_bytes -= it->first;
+			}
+		}
+	}
+
+	for (auto p : to_free) {
+		free(p);
+	}
+}
+
+size_t Docanto::BufferPool::get_budget() const {
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return m_budget;
+}
+
+void Docanto::BufferPool::trim() {
+	std::map<size_t, std::vector<byte*>> idle;
+	{
+		std::scoped_lock<std::mutex> lock(m_mutex);
+		std::swap(idle, m_idle);
+		m_idle_bytes = 0;
+	}
+
+	for (auto& [_, buffers] : idle) {
+		for (auto p : buffers) {
+			free(p);
+		}
+	}
+}
+
+Docanto::BufferPool::Statistics Docanto::BufferPool::get_statistics() const {
+	std::scoped_lock<std::mutex> lock(m_mutex);
+
+	Statistics stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	for (const auto& [_, buffers] : m_idle) {
+		stats.amount_idle += buffers.size();
+	}
+	stats.idle_bytes = m_idle_bytes;
+	stats.budget = m_budget;
+
+	return stats;
+}
@@ -0,0 +1,171 @@
+#include "ChromeTrace.h"
+#include "Logger.h"
+
+namespace {
+	std::string escape(const std::string& s) {
+		std::string out;
+		for (char c : s) {
+			if (c == '"' or c == '\\') {
+				out += '\\';
+			}
+			if (static_cast<unsigned char>(c) >= 0x20) {
+				out += c;
+			}
+		}
+		return out;
+	}
+}
+
+Docanto::ChromeTrace::Span::Span(const char* name, const char* category) : m_name(name), m_category(category) {
+	auto& trace = ChromeTrace::get_instance();
+	if (trace.is_enabled()) {
+		m_start = trace.now_us();
+	}
+}
+
+Docanto::ChromeTrace::Span::~Span() {
+	if (m_start < 0) {
+		return;
+	}
+
+	auto& trace = ChromeTrace::get_instance();
+	trace.add_span(m_name, m_category, m_start, trace.now_us(), std::move(m_args));
+}
+
+Docanto::ChromeTrace::Span& Docanto::ChromeTrace::Span::arg(const char* key, double value) {
+	if (m_start >= 0) {
+		m_args.push_back({ key, value });
+	}
+	return *this;
+}
+
+Docanto::ChromeTrace& Docanto::ChromeTrace::get_instance() {
+	static ChromeTrace instance;
+	return instance;
+}
+
+size_t Docanto::ChromeTrace::get_thread_index() {
+	static std::atomic_size_t next_index = 1;
+	thread_local size_t index = next_index.fetch_add(1);
+	return index;
+}
+
+void Docanto::ChromeTrace::start() {
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_events.clear();
+	m_enabled = true;
+}
+
+void Docanto::ChromeTrace::stop() {
+	m_enabled = false;
+}
+
+long long Docanto::ChromeTrace::now_us() const {
+	return m_epoch.delta_us();
+}
+
+void Docanto::ChromeTrace::set_thread_name(const std::string& name) {
+	auto tid = get_thread_index();
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_thread_names[tid] = name;
+}
+
+void Docanto::ChromeTrace::add_span(const char* name, const char* category, long long start_us, long long end_us, std::vector<Argument> args) {
+	if (!is_enabled()) {
+		return;
+	}
+
+	Event e;
+	e.name = name;
+	e.category = category;
+	e.phase = 'X';
+	e.tid = get_thread_index();
+	e.ts = start_us;
+	e.dur = std::max(end_us - start_us, 0LL);
+	e.args = std::move(args);
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_events.push_back(std::move(e));
+}
+
+void Docanto::ChromeTrace::add_async_span(const char* name, const char* category, size_t id, long long start_us, long long end_us, std::vector<Argument> args) {
+	if (!is_enabled()) {
+		return;
+	}
+
+	Event begin;
+	begin.name = name;
+	begin.category = category;
+	begin.phase = 'b';
+	begin.tid = get_thread_index();
+	begin.ts = start_us;
+	begin.id = id;
+	begin.args = std::move(args);
+
+	Event end = begin;
+	end.phase = 'e';
+	end.ts = std::max(end_us, start_us);
+	end.args.clear();
+
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	m_events.push_back(std::move(begin));
+	m_events.push_back(std::move(end));
+}
+
+bool Docanto::ChromeTrace::save(const std::filesystem::path& p) const {
+	std::scoped_lock<std::mutex> lock(m_mutex);
+
+	std::error_code ec;
+	if (p.has_parent_path()) {
+		std::filesystem::create_directories(p.parent_path(), ec);
+	}
+
+	std::ofstream out(p);
+	if (!out) {
+		Logger::error("Could not write the trace to ", p);
+		return false;
+	}
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&]() -> std::ofstream& {
+		if (!first) {
+			out << ",\n";
+		}
+		first = false;
+		return out;
+	};
+
+	for (const auto& [tid, name] : m_thread_names) {
+		separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+	}
+
+	for (const auto& e : m_events) {
+		separator() << "{\"name\":\"" << escape(e.name) << "\",\"cat\":\"" << escape(e.category) << "\",\"ph\":\"" << e.phase
+			<< "\",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.ts;
+
+		if (e.phase == 'X') {
+			out << ",\"dur\":" << e.dur;
+		}
+		else {
+			out << ",\"id\":" << e.id;
+		}
+
+		if (!e.args.empty()) {
+			out << ",\"args\":{";
+			for (size_t i = 0; i < e.args.size(); i++) {
+				out << (i == 0 ? "" : ",") << "\"" << escape(e.args.at(i).key) << "\":" << e.args.at(i).value;
+			}
+			out << "}";
+		}
+		out << "}";
+	}
+	out << "\n]}\n";
+
+	return static_cast<bool>(out);
+}
+
+size_t Docanto::ChromeTrace::get_amount_events() const {
+	std::scoped_lock<std::mutex> lock(m_mutex);
+	return m_events.size();
+}
@@ -0,0 +1,211 @@
+#include "DiskStore.h"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+
+struct Docanto::DiskStore::impl {
+	struct Entry {
+		std::string name;
+		size_t bytes = 0;
+	};
+
+	std::filesystem::path m_directory;
+	std::filesystem::path m_extension;
+
+	// the front of the list is the most recently used file
+	std::list<Entry> m_lru;
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_files;
+	mutable std::mutex m_mutex;
+
+	size_t m_budget = 0;
+	size_t m_bytes = 0;
+
+	std::atomic_size_t m_temp_counter = 0;
+
+	std::filesystem::path get_path(const std::string& name) const {
+		auto p = m_directory / name;
+		p += m_extension;
+		return p;
+	}
+
+	void erase(std::list<Entry>::iterator it) {
+		std::error_code ec;
+		std::filesystem::remove(get_path(it->name), ec);
+
+		m_bytes -= it->bytes;
+		m_files.erase(it->name);
+		m_lru.erase(it);
+	}
+
+	void evict() {
+		while (m_bytes > m_budget and !m_lru.empty()) {
+			erase(std::prev(m_lru.end()));
+		}
+	}
+};
+
+Docanto::DiskStore::DiskStore(const std::filesystem::path& directory, const std::filesystem::path& extension, size_t budget) : pimpl(std::make_unique<impl>()) {
+	pimpl->m_directory = directory;
+	pimpl->m_extension = extension;
+	pimpl->m_budget = budget;
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+	if (ec) {
+		Logger::error("Could not create the directory ", directory);
+		return;
+	}
+
+	// the last write time of a file is updated on every access, so the order survives a restart
+	std::vector<std::pair<std::filesystem::file_time_type, impl::Entry>> found;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+		if (!entry.is_regular_file(ec)) {
+			continue;
+		}
+
+		// files which were not finished before the application was closed
+		if (entry.path().extension() == ".tmp") {
+			std::filesystem::remove(entry.path(), ec);
+			continue;
+		}
+
+		if (entry.path().extension() != extension) {
+			continue;
+		}
+
+		found.push_back({ entry.last_write_time(ec), { entry.path().stem().string(), static_cast<size_t>(entry.file_size(ec)) } });
+	}
+
+	std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+		return a.first > b.first;
+	});
+
+	for (auto& [_, entry] : found) {
+		pimpl->m_bytes += entry.bytes;
+		pimpl->m_lru.push_back(entry);
+		pimpl->m_files[entry.name] = std::prev(pimpl->m_lru.end());
+	}
+
+	pimpl->evict();
+	Logger::log("Found ", pimpl->m_files.size(), " files with ", pimpl->m_bytes / 1024 / 1024, "MiB in ", directory);
+}
+
+Docanto::DiskStore::~DiskStore() = default;
+
+bool Docanto::DiskStore::store(const std::string& name, const std::vector<std::pair<const byte*, size_t>>& parts) {
+	// the file is written to a temporary file first, so no other reader will ever see a half written file
+	auto temp = pimpl->m_directory / (name + "." + std::to_string(pimpl->m_temp_counter.fetch_add(1)) + ".tmp");
+	size_t bytes = 0;
+	{
+		std::ofstream stream(temp, std::ios::binary);
+		if (!stream.is_open()) {
+			return false;
+		}
+
+		for (const auto& [data, len] : parts) {
+			stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(len));
+			bytes += len;
+		}
+
+		if (!stream) {
+			stream.close();
+			std::error_code ec;
+			std::filesystem::remove(temp, ec);
+			return false;
+		}
+	}
+
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	std::error_code ec;
+	std::filesystem::rename(temp, pimpl->get_path(name), ec);
+	if (ec) {
+		std::filesystem::remove(temp, ec);
+		return false;
+	}
+
+	auto it = pimpl->m_files.find(name);
+	if (it != pimpl->m_files.end()) {
+		pimpl->m_bytes -= it->second->bytes;
+		pimpl->m_lru.erase(it->second);
+		pimpl->m_files.erase(it);
+	}
+
+	pimpl->m_lru.push_front({ name, bytes });
+	pimpl->m_files[name] = pimpl->m_lru.begin();
+	pimpl->m_bytes += bytes;
+
+	pimpl->evict();
+	return true;
+}
+
+std::optional<Docanto::MappedFile> Docanto::DiskStore::load(const std::string& name) {
+	std::filesystem::path path;
+	{
+		std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+		auto it = pimpl->m_files.find(name);
+		if (it == pimpl->m_files.end()) {
+			return std::nullopt;
+		}
+
+		// move it to the front
+		pimpl->m_lru.splice(pimpl->m_lru.begin(), pimpl->m_lru, it->second);
+		path = pimpl->get_path(name);
+	}
+
+	auto file = MappedFile::open(path);
+
+	// the file was deleted in the meantime
+	if (!file.has_value()) {
+		remove(name);
+		return std::nullopt;
+	}
+
+	// keeps the order of the files for the next time the store is opened
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+	return file;
+}
+
+bool Docanto::DiskStore::contains(const std::string& name) const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_files.contains(name);
+}
+
+void Docanto::DiskStore::remove(const std::string& name) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	auto it = pimpl->m_files.find(name);
+	if (it != pimpl->m_files.end()) {
+		pimpl->erase(it->second);
+	}
+}
+
+void Docanto::DiskStore::clear() {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	while (!pimpl->m_lru.empty()) {
+		pimpl->erase(pimpl->m_lru.begin());
+	}
+}
+
+void Docanto::DiskStore::set_budget(size_t bytes) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	pimpl->m_budget = bytes;
+	pimpl->evict();
+}
+
+size_t Docanto::DiskStore::get_budget() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_budget;
+}
+
+size_t Docanto::DiskStore::get_size() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_bytes;
+}
+
+size_t Docanto::DiskStore::get_amount_files() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_files.size();
+}
@@ -1,5 +1,7 @@
 #include "File.h"
 
+#include <cstring>
+
 Docanto::File::File(Docanto::File&& other) noexcept {
 	std::swap(data, other.data);
 	this->size = other.size;
@@ -22,6 +24,37 @@ Docanto::File& Docanto::File::operator=(File&& other) noexcept {
 	return *this;
 }
 
+uint64_t Docanto::File::get_content_hash() const {
+	// hashing byte by byte takes too long for big files. The words are spread over independent
+	// lanes so the multiplications of one lane don't have to wait for the other ones
+	constexpr size_t LANES = 4;
+	constexpr size_t BLOCK = LANES * sizeof(uint64_t);
+	uint64_t lanes[LANES] = { 0xcbf29ce484222325, 0x9e3779b97f4a7c15, 0xc2b2ae3d27d4eb4f, 0x165667b19e3779f9 };
+
+	size_t amount_blocks = size / BLOCK;
+	for (size_t i = 0; i < amount_blocks; i++) {
+		for (size_t l = 0; l < LANES; l++) {
+			uint64_t word;
+			std::memcpy(&word, data.get() + i * BLOCK + l * sizeof(uint64_t), sizeof(word));
+			lanes[l] = (lanes[l] ^ word) * 0x100000001b3;
+			// the multiplication only carries upwards, the high bits are folded back into the low ones
+			lanes[l] ^= lanes[l] >> 29;
+		}
+	}
+
+	auto seed = hash(reinterpret_cast<const byte*>(lanes), sizeof(lanes));
+	return hash(data.get() + amount_blocks * BLOCK, size - amount_blocks * BLOCK, seed);
+}
+
+uint64_t Docanto::File::hash(const byte* data, size_t len, uint64_t seed) {
+	for (size_t i = 0; i < len; i++) {
+		seed ^= data[i];
+		seed *= 0x100000001b3;
+	}
+
+	return seed;
+}
+
 std::optional<Docanto::File> Docanto::File::load(const std::filesystem::path& p) {
 	if (!std::filesystem::exists(p)) {
 		// Log error: file does not exist
@@ -45,7 +78,7 @@ std::optional<Docanto::File> Docanto::File::load(const std::filesystem::path& p)
 	}
 
 	auto size = stream.tellg();
-	auto file_buffer = std::unique_ptr<byte>(new byte[static_cast<size_t>(size)]);
+	auto file_buffer = ByteBuffer(new byte[static_cast<size_t>(size)]);
 
 	stream.seekg(0, std::ios::beg);
 	if (!stream.read(reinterpret_cast<char*>(file_buffer.get()), size)) {
@@ -1,6 +1,14 @@
 #include "Image.h"
+#include "BufferPool.h"
 
-Docanto::Image::Image(std::unique_ptr<byte> data, size_t size, size_t width) : File(std::move(data), size) {
+#include <cstring>
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_AMD64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define DOCANTO_SSE2
+#endif
+
+Docanto::Image::Image(ByteBuffer data, size_t size, size_t width) : File(std::move(data), size) {
 	dims = { size, width };
 }
 
@@ -22,4 +30,107 @@ Docanto::Image& Docanto::Image::operator=(Image&& other) noexcept {
 	}
 
 	return *this;
-}
\ No newline at end of file
+}
+
+namespace {
+	// swaps the first and third byte of every pixel
+	inline uint32_t swap_red_blue(uint32_t p) {
+		return (p & 0xff00ff00u) | ((p >> 16) & 0xffu) | ((p & 0xffu) << 16);
+	}
+
+#ifdef DOCANTO_SSE2
+	inline __m128i swap_red_blue(__m128i p) {
+		auto ga = _mm_and_si128(p, _mm_set1_epi32(static_cast<int>(0xff00ff00u)));
+		auto b = _mm_and_si128(_mm_srli_epi32(p, 16), _mm_set1_epi32(0xff));
+		auto r = _mm_and_si128(_mm_slli_epi32(p, 16), _mm_set1_epi32(0xff0000));
+		return _mm_or_si128(ga, _mm_or_si128(r, b));
+	}
+
+	// averages the 2x2 blocks of eight pixels of both rows into four pixels
+	inline __m128i downsample_8_pixels(const byte* row0, const byte* row1) {
+		const auto zero = _mm_setzero_si128();
+		auto a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+		auto a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 16));
+		auto b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+		auto b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16));
+
+		// the columns are summed up in 16 bit, every 64 bit lane holds one pixel
+		auto s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+		auto s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+		auto s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+		auto s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+		// then the neighbouring pixels are added and the sum is rounded
+		const auto two = _mm_set1_epi16(2);
+		auto h0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+		auto h1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+		h0 = _mm_srli_epi16(_mm_add_epi16(h0, two), 2);
+		h1 = _mm_srli_epi16(_mm_add_epi16(h1, two), 2);
+
+		return _mm_packus_epi16(h0, h1);
+	}
+#endif // DOCANTO_SSE2
+}
+
+Docanto::Image Docanto::downsample_image(const Image& src, bool swap) {
+	Image dst;
+	if (src.data == nullptr or src.components != 4) {
+		return dst;
+	}
+
+	size_t w = src.dims.width / 2;
+	size_t h = src.dims.height / 2;
+	dst.stride = BufferPool::get_aligned_stride(w * 4);
+	dst.size = dst.stride * h;
+	dst.data = BufferPool::get_instance().acquire(std::max<size_t>(dst.size, 1));
+	dst.components = 4;
+	dst.dims = { w, h };
+	dst.dpi = src.dpi / 2;
+
+	for (size_t y = 0; y < h; y++) {
+		const byte* row0 = src.data.get() + 2 * y * src.stride;
+		const byte* row1 = row0 + src.stride;
+		byte* out = dst.data.get() + y * dst.stride;
+
+		size_t x = 0;
+#ifdef DOCANTO_SSE2
+		for (; x + 4 <= w; x += 4) {
+			auto p = downsample_8_pixels(row0 + x * 8, row1 + x * 8);
+			if (swap) {
+				p = swap_red_blue(p);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), p);
+		}
+#endif // DOCANTO_SSE2
+
+		for (; x < w; x++) {
+			const byte* a = row0 + x * 8;
+			const byte* b = row1 + x * 8;
+
+			uint32_t p = 0;
+			for (size_t c = 0; c < 4; c++) {
+				uint32_t sum = a[c] + a[c + 4] + b[c] + b[c + 4] + 2;
+				p |= (sum >> 2) << (8 * c);
+			}
+			if (swap) {
+				p = swap_red_blue(p);
+			}
+			std::memcpy(out + x * 4, &p, 4);
+		}
+	}
+
+	return dst;
+}
+
+void Docanto::copy_image(const Image& src, Image& dst, size_t x, size_t y) {
+	if (src.data == nullptr or dst.data == nullptr or src.components != dst.components or
+		x >= dst.dims.width or y >= dst.dims.height) {
+		return;
+	}
+
+	size_t w = std::min(src.dims.width, dst.dims.width - x);
+	size_t h = std::min(src.dims.height, dst.dims.height - y);
+	for (size_t row = 0; row < h; row++) {
+		std::memcpy(dst.data.get() + (y + row) * dst.stride + x * dst.components, src.data.get() + row * src.stride, w * src.components);
+	}
+}
@@ -0,0 +1,121 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#ifndef _UNICODE
+	#define _UNICODE
+	#endif // !_UNICODE
+
+	#ifndef UNICODE
+	#define UNICODE
+	#endif // !UNICODE
+
+	#ifndef NOMINMAX
+	#define NOMINMAX
+	#endif // !NOMINMAX
+
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif // _WIN32
+
+Docanto::MappedFile::~MappedFile() {
+	unmap();
+}
+
+Docanto::MappedFile::MappedFile(MappedFile&& other) noexcept {
+	std::swap(m_data, other.m_data);
+	std::swap(m_size, other.m_size);
+	std::swap(m_mapping, other.m_mapping);
+}
+
+Docanto::MappedFile& Docanto::MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		unmap();
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_mapping, other.m_mapping);
+	}
+
+	return *this;
+}
+
+void Docanto::MappedFile::unmap() {
+	if (m_data == nullptr) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+#else
+	munmap(const_cast<byte*>(m_data), m_size);
+#endif // _WIN32
+
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+}
+
+std::optional<Docanto::MappedFile> Docanto::MappedFile::open(const std::filesystem::path& p) {
+	std::error_code ec;
+	auto size = std::filesystem::file_size(p, ec);
+
+	// empty files can not be mapped
+	if (ec or size == 0) {
+		return std::nullopt;
+	}
+
+	MappedFile file;
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) {
+		return std::nullopt;
+	}
+
+	// the mapping keeps the file open, so the handle can be closed right away
+	HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(handle);
+	if (mapping == nullptr) {
+		Logger::error("Could not map the file ", p);
+		return std::nullopt;
+	}
+
+	auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		Logger::error("Could not map the file ", p);
+		CloseHandle(mapping);
+		return std::nullopt;
+	}
+
+	file.m_mapping = mapping;
+	file.m_data = reinterpret_cast<const byte*>(view);
+#else
+	int fd = ::open(p.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return std::nullopt;
+	}
+
+	auto view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED) {
+		Logger::error("Could not map the file ", p);
+		return std::nullopt;
+	}
+
+	file.m_data = reinterpret_cast<const byte*>(view);
+#endif // _WIN32
+
+	file.m_size = static_cast<size_t>(size);
+	return file;
+}
+
+const byte* Docanto::MappedFile::data() const {
+	return m_data;
+}
+
+size_t Docanto::MappedFile::size() const {
+	return m_size;
+}
@@ -0,0 +1,147 @@
+#include "SharedMutex.h"
+#include "Logger.h"
+
+namespace {
+	// a lock which the thread holds
+	struct HeldLock {
+		const Docanto::ReentrantSharedMutex* mutex = nullptr;
+		uint32_t reads = 0;
+		uint32_t writes = 0;
+		// the reads are counted in the slot of the thread. Reads which are taken while the thread writes are not
+		bool counted = false;
+	};
+
+	// a thread rarely holds more than a few locks at once, so a list is faster than any map
+	thread_local std::vector<HeldLock> t_held_locks;
+
+	std::atomic_size_t g_next_slot = 0;
+	thread_local size_t t_slot = g_next_slot.fetch_add(1) % Docanto::ReentrantSharedMutex::AMOUNT_SLOTS;
+
+	HeldLock* find_held(const Docanto::ReentrantSharedMutex* mutex) {
+		for (auto& held : t_held_locks) {
+			if (held.mutex == mutex) {
+				return &held;
+			}
+		}
+		return nullptr;
+	}
+
+	void forget_if_released(HeldLock* held) {
+		if (held->reads != 0 or held->writes != 0) {
+			return;
+		}
+
+		*held = t_held_locks.back();
+		t_held_locks.pop_back();
+	}
+}
+
+uint32_t Docanto::ReentrantSharedMutex::count_readers() const {
+	uint32_t amount = 0;
+	for (const auto& slot : m_slots) {
+		amount += slot.readers.load();
+	}
+	return amount;
+}
+
+void Docanto::ReentrantSharedMutex::signal_release() {
+	m_release_signal.fetch_add(1);
+	m_release_signal.notify_all();
+}
+
+void Docanto::ReentrantSharedMutex::lock_shared() {
+	// the thread already reads or writes, it must not wait for the writers behind it
+	auto held = find_held(this);
+	if (held != nullptr) {
+		held->reads++;
+		return;
+	}
+
+	auto& slot = m_slots.at(t_slot).readers;
+	while (true) {
+		// the reader announces itself before it looks for a writer and the writer does it the other way around,
+		// so at least one of them sees the other
+		slot.fetch_add(1);
+		if (m_writer.load() == 0) {
+			break;
+		}
+
+		slot.fetch_sub(1);
+		signal_release();
+		m_writer.wait(1);
+	}
+
+	t_held_locks.push_back({ this, 1, 0, true });
+}
+
+void Docanto::ReentrantSharedMutex::unlock_shared() {
+	auto held = find_held(this);
+	if (held == nullptr or held->reads == 0) {
+		Logger::error("The read lock was released by a thread which does not hold it");
+		return;
+	}
+
+	held->reads--;
+	if (held->reads == 0 and held->counted) {
+		held->counted = false;
+		m_slots.at(t_slot).readers.fetch_sub(1);
+
+		if (m_writer.load() != 0) {
+			signal_release();
+		}
+	}
+	forget_if_released(held);
+}
+
+void Docanto::ReentrantSharedMutex::lock() {
+	auto held = find_held(this);
+	if (held != nullptr and held->writes != 0) {
+		held->writes++;
+		return;
+	}
+
+	m_writer_mutex.lock();
+	m_writer.store(1);
+
+	// a thread which upgrades its read lock is counted once itself
+	uint32_t own = held != nullptr and held->counted ? 1 : 0;
+	while (true) {
+		auto signal = m_release_signal.load();
+		if (count_readers() == own) {
+			break;
+		}
+		m_release_signal.wait(signal);
+	}
+
+	if (held == nullptr) {
+		t_held_locks.push_back({ this, 0, 1, false });
+	}
+	else {
+		held->writes = 1;
+	}
+}
+
+void Docanto::ReentrantSharedMutex::unlock() {
+	auto held = find_held(this);
+	if (held == nullptr or held->writes == 0) {
+		Logger::error("The write lock was released by a thread which does not hold it");
+		return;
+	}
+
+	held->writes--;
+	if (held->writes != 0) {
+		return;
+	}
+
+	// the reads which were taken while writing are kept, so they have to be counted before another writer can start
+	if (held->reads != 0 and !held->counted) {
+		m_slots.at(t_slot).readers.fetch_add(1);
+		held->counted = true;
+	}
+
+	m_writer.store(0);
+	m_writer_mutex.unlock();
+	m_writer.notify_all();
+
+	forget_if_released(held);
+}
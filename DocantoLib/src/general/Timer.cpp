@@ -74,7 +74,7 @@ long long Timer::delta_h() const {
 std::wostream& Docanto::Timer::to_string(std::wostream& sstream) const {
 	auto us = delta_us();
 	if (us < 1000) {
-		return sstream << us << L"s";
+		return sstream << us << L"\u00b5s";
 	}
 
 	auto ms = delta_ms();
@@ -99,7 +99,7 @@ std::wostream& Docanto::Timer::to_string(std::wostream& sstream) const {
 	return sstream << h << L"h " << m << L"m " << s << L"s " << ms << L"ms";
 }
 
-std::wostream& operator<<(std::wostream& os, const Docanto::Timer& timer) {
+std::wostream& Docanto::operator<<(std::wostream& os, const Docanto::Timer& timer) {
 	timer.to_string(os);
 	return os;
 }
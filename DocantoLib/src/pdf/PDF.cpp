@@ -38,8 +38,8 @@ Docanto::PDF::PDF(const std::filesystem::path& p) {
 }
 
 Docanto::PDF::~PDF() {
-	auto doc = this->get();
 	auto ctx = GlobalPDFContext::get_instance().get();
+	auto doc = this->get();
 
 	for (size_t i = 0; i < m_pages.size(); i++) {
 		auto pag = m_pages.at(i).get();
@@ -64,6 +64,7 @@ Docanto::Geometry::Dimension<float> Docanto::PDF::get_page_dimension(size_t page
 	auto scale = dpi / MUPDF_DEFAULT_DPI;
 
 	auto ctx = GlobalPDFContext::get_instance().get();
+	auto doc = this->get();
 
 	auto s = fz_bound_page(*ctx, *(get_page(page).get()));
 	
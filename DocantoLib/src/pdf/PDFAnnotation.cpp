@@ -34,6 +34,20 @@ Docanto::PDFAnnotation::AnnotationType to_annot_type(enum pdf_annot_type t);
 
 struct Docanto::PDFAnnotation::impl {
 	std::vector<std::vector<std::pair<std::shared_ptr<AnnotationInfo>, AnnotationWrapper>>> all_annotations;
+	// the areas of each page which have to be rendered again
+	std::vector<std::vector<Geometry::Rectangle<float>>> changed_areas;
+
+	void add_changed_area(const AnnotationInfo& info) {
+		auto rec = info.bounding_box;
+
+		// the bounding box of a new ink annotation only covers the points, not the stroke
+		float border = 1.0f;
+		if (info.type == AnnotationType::INK_ANNOTATION) {
+			border += static_cast<const InkAnnotationInfo&>(info).stroke_width;
+		}
+
+		changed_areas.at(info.page).push_back({ rec.x - border, rec.y - border, rec.width + 2 * border, rec.height + 2 * border });
+	}
 
 	impl() = default;
 	~impl() = default;
@@ -110,6 +124,8 @@ void Docanto::PDFAnnotation::parse_annotation() {
 	size_t count = 0;
 
 	auto ctx = Docanto::GlobalPDFContext::get_instance().get();
+	// the render threads read the document while holding its lock
+	auto doc = pdf_obj->get();
 	auto page_amount = pdf_obj->get_page_count();
 
 	for (size_t curr_page = 0; curr_page < page_amount; curr_page++) {
@@ -141,6 +157,7 @@ void Docanto::PDFAnnotation::parse_annotation() {
 			annot = pdf_next_annot(*ctx, annot);
 		} 
 	}
+	pimpl->changed_areas.resize(pimpl->all_annotations.size());
 
 	Logger::log("Parsed ", count, " annotations in ", time);
 }
@@ -153,8 +170,9 @@ Docanto::PDFAnnotation::~PDFAnnotation() {
 }
 
 void Docanto::PDFAnnotation::add_annotation(size_t page, const std::vector<Geometry::Point<float>>& all_ponts, Color c, float width) {
-	auto fzpage = pdf_obj->get_page(page).get();
 	auto ctx = Docanto::GlobalPDFContext::get_instance().get();
+	auto doc = pdf_obj->get();
+	auto fzpage = pdf_obj->get_page(page).get();
 
 	pdf_annot* annot = pdf_create_annot(*ctx, reinterpret_cast<pdf_page*>(*fzpage), PDF_ANNOT_INK);
 	int count[1] = { static_cast<int>(all_ponts.size()) };
@@ -190,8 +208,10 @@ void Docanto::PDFAnnotation::add_annotation(size_t page, const std::vector<Geome
 	info->stroke_width = width;
 	info->type = PDFAnnotation::AnnotationType::INK_ANNOTATION;
 	info->points = std::make_shared<std::vector<Geometry::Point<float>>>(all_ponts);
+	info->page = page;
 	
 	pimpl->all_annotations[page].push_back({ info, annot });
+	pimpl->add_changed_area(*info);
 }
 
 std::vector<std::shared_ptr<Docanto::PDFAnnotation::AnnotationInfo>> Docanto::PDFAnnotation::get_annotation(size_t page, Geometry::Rectangle<float> rec) {
@@ -210,6 +230,7 @@ std::vector<std::shared_ptr<Docanto::PDFAnnotation::AnnotationInfo>> Docanto::PD
 
 void Docanto::PDFAnnotation::remove_annotation(std::shared_ptr<AnnotationInfo> annot) {
 	auto ctx = GlobalPDFContext::get_instance().get();
+	auto doc = pdf_obj->get();
 	auto& annot_page = pimpl->all_annotations[annot->page]; 
 	auto fzpage = pdf_obj->get_page(annot->page).get();
 
@@ -222,9 +243,14 @@ void Docanto::PDFAnnotation::remove_annotation(std::shared_ptr<AnnotationInfo> a
 	}
 
 	pdf_delete_annot(*ctx, reinterpret_cast<pdf_page*>(*fzpage), it->second.obj);
+	pimpl->add_changed_area(*annot);
 	annot_page.erase(it);
 }
 
+std::vector<Docanto::Geometry::Rectangle<float>> Docanto::PDFAnnotation::take_changed_areas(size_t page) {
+	return std::exchange(pimpl->changed_areas.at(page), {});
+}
+
 
 
 Docanto::PDFAnnotation::AnnotationType to_annot_type(enum pdf_annot_type t) {
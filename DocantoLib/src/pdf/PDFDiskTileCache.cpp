@@ -0,0 +1,119 @@
+#include "PDFDiskTileCache.h"
+
+#include "../../include/general/DiskStore.h"
+
+#include <cstring>
+
+namespace {
+	// the header in front of the pixels of every tile file
+	struct TileHeader {
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t width = 0;
+		uint64_t height = 0;
+		uint64_t stride = 0;
+		uint64_t components = 0;
+		uint64_t dpi = 0;
+		uint64_t size = 0;
+	};
+
+	constexpr uint32_t TILE_MAGIC = 0x4C495444; // "DTIL"
+	constexpr uint32_t TILE_VERSION = 1;
+
+	std::string get_name(const Docanto::PDFDiskTileCache::TileKey& key) {
+		char name[128];
+		std::snprintf(name, sizeof(name), "%016llx_%zu_%zu_%zu_%zu_%zu", static_cast<unsigned long long>(key.content_hash), key.page, key.zoom, key.level, key.x, key.y);
+		return name;
+	}
+}
+
+struct Docanto::PDFDiskTileCache::impl {
+	std::unique_ptr<DiskStore> m_store;
+};
+
+Docanto::PDFDiskTileCache::PDFDiskTileCache(const std::filesystem::path& directory, size_t budget) : pimpl(std::make_unique<impl>()) {
+	pimpl->m_store = std::make_unique<DiskStore>(directory, ".tile", budget);
+}
+
+Docanto::PDFDiskTileCache::~PDFDiskTileCache() = default;
+
+bool Docanto::PDFDiskTileCache::store(const TileKey& key, const Image& img) {
+	if (img.data == nullptr or img.size == 0) {
+		return false;
+	}
+
+	TileHeader header;
+	header.magic = TILE_MAGIC;
+	header.version = TILE_VERSION;
+	header.width = img.dims.width;
+	header.height = img.dims.height;
+	header.stride = img.stride;
+	header.components = img.components;
+	header.dpi = img.dpi;
+	header.size = img.size;
+
+	return pimpl->m_store->store(get_name(key), {
+		{ reinterpret_cast<const byte*>(&header), sizeof(header) },
+		{ img.data.get(), img.size }
+	});
+}
+
+std::optional<Docanto::Image> Docanto::PDFDiskTileCache::load(const TileKey& key) {
+	auto name = get_name(key);
+	auto file = pimpl->m_store->load(name);
+	if (!file.has_value()) {
+		return std::nullopt;
+	}
+
+	TileHeader header;
+	bool valid = file->size() >= sizeof(header);
+	if (valid) {
+		std::memcpy(&header, file->data(), sizeof(header));
+		valid = header.magic == TILE_MAGIC and header.version == TILE_VERSION and
+			header.stride * header.height <= header.size and file->size() - sizeof(header) == header.size;
+	}
+
+	// the file is broken
+	if (!valid) {
+		file.reset();
+		pimpl->m_store->remove(name);
+		return std::nullopt;
+	}
+
+	Image img;
+	img.data = BufferPool::get_instance().acquire(header.size);
+	std::memcpy(img.data.get(), file->data() + sizeof(header), header.size);
+	img.size = header.size;
+	img.dims = { static_cast<size_t>(header.width), static_cast<size_t>(header.height) };
+	img.stride = header.stride;
+	img.components = header.components;
+	img.dpi = header.dpi;
+
+	return img;
+}
+
+bool Docanto::PDFDiskTileCache::contains(const TileKey& key) const {
+	return pimpl->m_store->contains(get_name(key));
+}
+
+void Docanto::PDFDiskTileCache::clear() {
+	pimpl->m_store->clear();
+}
+
+void Docanto::PDFDiskTileCache::set_budget(size_t bytes) {
+	pimpl->m_store->set_budget(bytes);
+}
+
+size_t Docanto::PDFDiskTileCache::get_budget() const {
+	return pimpl->m_store->get_budget();
+}
+
+size_t Docanto::PDFDiskTileCache::get_size() const {
+	return pimpl->m_store->get_size();
+}
+
+std::filesystem::path Docanto::PDFDiskTileCache::get_default_directory() {
+	std::error_code ec;
+	auto temp = std::filesystem::temp_directory_path(ec);
+	return temp / "Docanto" / "tiles";
+}
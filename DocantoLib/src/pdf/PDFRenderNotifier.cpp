@@ -0,0 +1,136 @@
+#include "PDFRenderNotifier.h"
+
+#include <chrono>
+
+struct Docanto::PDFRenderNotifier::impl {
+	typedef std::chrono::steady_clock clock;
+
+	std::function<void(const Batch&)> m_callback;
+	float m_interval_ms = DEFAULT_INTERVAL_MS;
+	bool m_flush_on_complete = false;
+
+	Batch m_pending;
+	// if each renderer has finished its viewport
+	std::map<size_t, bool> m_sources;
+	clock::time_point m_last_notification;
+
+	// the pending batch is sent without waiting for the interval
+	bool m_flush = false;
+	bool m_should_die = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::thread m_thread;
+
+	bool is_complete() const {
+		return std::all_of(m_sources.begin(), m_sources.end(), [](const auto& s) { return s.second; });
+	}
+
+	void run() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (true) {
+			m_condition.wait(lock, [this] { return m_should_die or !m_pending.ids.empty(); });
+			if (m_should_die) {
+				return;
+			}
+
+			// more images can be added while waiting for the interval to pass
+			auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float, std::milli>(m_interval_ms));
+			m_condition.wait_until(lock, m_last_notification + interval, [this] { return m_should_die or m_flush; });
+			if (m_should_die) {
+				return;
+			}
+
+			Batch batch = std::move(m_pending);
+			m_pending = Batch();
+			batch.complete = is_complete();
+			m_flush = false;
+			m_last_notification = clock::now();
+
+			lock.unlock();
+			m_callback(batch);
+			lock.lock();
+		}
+	}
+};
+
+Docanto::PDFRenderNotifier::PDFRenderNotifier(std::function<void(const Batch&)> callback, float interval_ms) : pimpl(std::make_unique<impl>()) {
+	pimpl->m_callback = callback;
+	pimpl->m_interval_ms = interval_ms;
+	pimpl->m_thread = std::thread([this] { pimpl->run(); });
+}
+
+Docanto::PDFRenderNotifier::~PDFRenderNotifier() {
+	{
+		std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+		pimpl->m_should_die = true;
+	}
+	pimpl->m_condition.notify_all();
+	pimpl->m_thread.join();
+}
+
+void Docanto::PDFRenderNotifier::set_interval(float ms) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	pimpl->m_interval_ms = ms;
+}
+
+float Docanto::PDFRenderNotifier::get_interval() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_interval_ms;
+}
+
+void Docanto::PDFRenderNotifier::set_flush_on_complete(bool b) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	pimpl->m_flush_on_complete = b;
+}
+
+void Docanto::PDFRenderNotifier::add(size_t source, size_t image_id, const Geometry::Rectangle<float>& rec) {
+	{
+		std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+		auto& pending = pimpl->m_pending;
+
+		pending.dirty = pending.ids.empty() ? rec : pending.dirty.merge(rec);
+		pending.ids.push_back(image_id);
+		pimpl->m_sources.try_emplace(source, false);
+
+		if (pimpl->m_flush_on_complete and pimpl->is_complete()) {
+			pimpl->m_flush = true;
+		}
+	}
+	pimpl->m_condition.notify_all();
+}
+
+void Docanto::PDFRenderNotifier::set_complete(size_t source, bool complete) {
+	{
+		std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+		pimpl->m_sources[source] = complete;
+
+		if (!pimpl->m_flush_on_complete or !complete or pimpl->m_pending.ids.empty() or !pimpl->is_complete()) {
+			return;
+		}
+		pimpl->m_flush = true;
+	}
+	pimpl->m_condition.notify_all();
+}
+
+void Docanto::PDFRenderNotifier::remove_source(size_t source) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	pimpl->m_sources.erase(source);
+}
+
+bool Docanto::PDFRenderNotifier::is_complete() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->is_complete();
+}
+
+void Docanto::PDFRenderNotifier::flush() {
+	{
+		std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+		if (pimpl->m_pending.ids.empty()) {
+			return;
+		}
+		pimpl->m_flush = true;
+	}
+	pimpl->m_condition.notify_all();
+}
@@ -0,0 +1,142 @@
+#include "PDFRenderStatistics.h"
+
+#include <bit>
+#include <cmath>
+
+namespace {
+	constexpr auto RELAXED = std::memory_order_relaxed;
+
+	double get_rate(size_t hits, size_t misses) {
+		return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses);
+	}
+}
+
+double Docanto::PDFRenderStatistics::Histogram::Snapshot::mean() const {
+	return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t Docanto::PDFRenderStatistics::Histogram::Snapshot::percentile(double p) const {
+	if (count == 0) {
+		return 0;
+	}
+
+	auto rank = static_cast<size_t>(std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * count));
+	rank = std::max<size_t>(rank, 1);
+
+	size_t seen = 0;
+	for (size_t i = 0; i < AMOUNT_BUCKETS; i++) {
+		seen += buckets.at(i);
+		if (seen >= rank) {
+			// the bucket limit may be far above anything that was counted
+			return std::min(get_bucket_limit(i), max);
+		}
+	}
+	return max;
+}
+
+void Docanto::PDFRenderStatistics::Histogram::add(uint64_t value) {
+	auto bucket = std::min<size_t>(std::bit_width(value), AMOUNT_BUCKETS - 1);
+	m_buckets.at(bucket).fetch_add(1, RELAXED);
+	m_count.fetch_add(1, RELAXED);
+	m_sum.fetch_add(value, RELAXED);
+
+	auto current = m_max.load(RELAXED);
+	while (current < value and !m_max.compare_exchange_weak(current, value, RELAXED)) {}
+}
+
+Docanto::PDFRenderStatistics::Histogram::Snapshot Docanto::PDFRenderStatistics::Histogram::snapshot() const {
+	Snapshot s;
+	for (size_t i = 0; i < AMOUNT_BUCKETS; i++) {
+		s.buckets.at(i) = m_buckets.at(i).load(RELAXED);
+	}
+	s.count = m_count.load(RELAXED);
+	s.sum = m_sum.load(RELAXED);
+	s.max = m_max.load(RELAXED);
+	return s;
+}
+
+uint64_t Docanto::PDFRenderStatistics::Histogram::get_bucket_limit(size_t bucket) {
+	if (bucket == 0) {
+		return 0;
+	}
+	if (bucket >= 64) {
+		return UINT64_MAX;
+	}
+	return (uint64_t(1) << bucket) - 1;
+}
+
+const Docanto::PDFRenderStatistics::JobCounters& Docanto::PDFRenderStatistics::Snapshot::get(JobKind kind) const {
+	return jobs.at(static_cast<size_t>(kind));
+}
+
+double Docanto::PDFRenderStatistics::Snapshot::get_tile_cache_hit_rate() const {
+	return get_rate(tile_cache.hits, tile_cache.misses);
+}
+
+double Docanto::PDFRenderStatistics::Snapshot::get_disk_hit_rate() const {
+	return get_rate(disk_hits, disk_misses);
+}
+
+double Docanto::PDFRenderStatistics::Snapshot::get_list_store_hit_rate() const {
+	return get_rate(list_store_hits, list_store_misses);
+}
+
+void Docanto::PDFRenderStatistics::add_queued(JobKind kind, size_t amount) {
+	m_jobs.at(static_cast<size_t>(kind)).queued.fetch_add(amount, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_completed(JobKind kind) {
+	m_jobs.at(static_cast<size_t>(kind)).completed.fetch_add(1, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_cancelled(JobKind kind) {
+	m_jobs.at(static_cast<size_t>(kind)).cancelled.fetch_add(1, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_wasted(JobKind kind) {
+	m_jobs.at(static_cast<size_t>(kind)).wasted.fetch_add(1, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_render_time(uint64_t us) {
+	m_render_time.add(us);
+}
+
+void Docanto::PDFRenderStatistics::add_list_build(uint64_t us, uint64_t bytes) {
+	m_list_build_time.add(us);
+	m_list_bytes.add(bytes);
+}
+
+void Docanto::PDFRenderStatistics::add_disk_lookup(bool hit) {
+	(hit ? m_disk_hits : m_disk_misses).fetch_add(1, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_list_store_lookup(bool hit) {
+	(hit ? m_list_store_hits : m_list_store_misses).fetch_add(1, RELAXED);
+}
+
+void Docanto::PDFRenderStatistics::add_mip_build() {
+	m_mip_builds.fetch_add(1, RELAXED);
+}
+
+Docanto::PDFRenderStatistics::Snapshot Docanto::PDFRenderStatistics::snapshot() const {
+	Snapshot s;
+	for (size_t i = 0; i < AMOUNT_JOB_KINDS; i++) {
+		const auto& c = m_jobs.at(i);
+		auto& out = s.jobs.at(i);
+		out.queued = c.queued.load(RELAXED);
+		out.completed = c.completed.load(RELAXED);
+		out.cancelled = c.cancelled.load(RELAXED);
+		out.wasted = c.wasted.load(RELAXED);
+	}
+
+	s.render_time_us = m_render_time.snapshot();
+	s.list_build_time_us = m_list_build_time.snapshot();
+	s.list_bytes = m_list_bytes.snapshot();
+
+	s.disk_hits = m_disk_hits.load(RELAXED);
+	s.disk_misses = m_disk_misses.load(RELAXED);
+	s.list_store_hits = m_list_store_hits.load(RELAXED);
+	s.list_store_misses = m_list_store_misses.load(RELAXED);
+	s.mip_builds = m_mip_builds.load(RELAXED);
+	return s;
+}
@@ -5,8 +5,14 @@
 
 #include "../../include/general/Timer.h"
 #include "../../include/general/ReadWriteMutex.h"
+#include "../../include/general/DiskStore.h"
+#include "../../include/general/ChromeTrace.h"
 
 #include <unordered_set>
+#include <cstring>
+#include <future>
+#include <list>
+#include <cmath>
 
 #define FLOAT_EQUAL(a, b) (std::abs(a - b) < 0.001)
 
@@ -31,23 +37,433 @@ struct fz_display_list {
 	size_t len;
 };
 
-struct DisplayListWrapper : public Docanto::ThreadSafeWrapper<fz_display_list*> {
-	using Docanto::ThreadSafeWrapper<fz_display_list*>::ThreadSafeWrapper;
+// A display list is never changed once it was recorded. It can therefore be run by all render
+// workers at the same time without any locking. The list is dropped with the last reference.
+struct DisplayListWrapper {
+	fz_display_list* const list = nullptr;
 
-	~DisplayListWrapper() {
-		auto d = get().get();
+	// The annotation layer is made of one list per annotation, so a single changed annotation does not
+	// require the whole layer to be recorded again. The pieces are drawn in order after the list
+	std::vector<std::shared_ptr<DisplayListWrapper>> pieces;
+	// the area the list draws to
+	fz_rect bounds = { 0, 0, 0, 0 };
+	// the object number of the annotation the list was recorded from, 0 if it is not known. Only the number
+	// is kept, a reference to the annotation could be dropped on any thread without holding the document
+	int annot_num = 0;
+
+	DisplayListWrapper(fz_display_list* list) : list(list) {}
+	DisplayListWrapper(std::vector<std::shared_ptr<DisplayListWrapper>>&& pieces) : pieces(std::move(pieces)) {}
 
-		if (d != nullptr) {
+	DisplayListWrapper(const DisplayListWrapper&) = delete;
+	DisplayListWrapper& operator=(const DisplayListWrapper&) = delete;
+
+	~DisplayListWrapper() {
+		if (list != nullptr) {
 			auto ctx = Docanto::GlobalPDFContext::get_instance().get();
-			fz_drop_display_list(*ctx, *d);
+			fz_drop_display_list(*ctx, list);
+		}
+	}
+
+	/// <summary>
+	/// The amount of bytes used by the nodes of the list and its pieces
+	/// </summary>
+	size_t get_size() const {
+		size_t size = list == nullptr ? 0 : list->len * sizeof(fz_display_node);
+		for (const auto& piece : pieces) {
+			size += piece->get_size();
+		}
+		return size;
+	}
+
+	/// <summary>
+	/// The amount of nodes of the list and its pieces
+	/// </summary>
+	size_t get_amount_nodes() const {
+		size_t amount = list == nullptr ? 0 : list->len;
+		for (const auto& piece : pieces) {
+			amount += piece->get_amount_nodes();
+		}
+		return amount;
+	}
+
+	/// <summary>
+	/// Runs the list and every piece which intersects the scissor
+	/// </summary>
+	/// <param name="scissor">The area which is drawn in device space</param>
+	void run(fz_context* ctx, fz_device* dev, fz_matrix ctm, fz_rect scissor, fz_cookie* cookie) const {
+		if (list != nullptr) {
+			fz_run_display_list(ctx, list, dev, ctm, scissor, cookie);
+		}
+
+		for (const auto& piece : pieces) {
+			if (cookie != nullptr and cookie->abort) {
+				return;
+			}
+
+			if (fz_is_empty_rect(fz_intersect_rect(fz_transform_rect(piece->bounds, ctm), scissor))) {
+				continue;
+			}
+			piece->run(ctx, dev, ctm, scissor, cookie);
 		}
 	}
 };
 
-Docanto::Image get_image_from_list(fz_context* ctx, fz_display_list* wrap, const Docanto::Geometry::Rectangle<float>& scissor, const float dpi, fz_cookie* cookie = nullptr);
+// The display lists of pages which only consist of paths can be stored on the disk. The nodes of such a
+// list are plain data, except for the stroke states which are referenced by pointer. They are written
+// next to the nodes and created again when the list is loaded. Lists which reference fonts, images,
+// shadings or other colorspaces can not be stored and are always interpreted.
+namespace DisplayListFormat {
+	// these mirror the private enums of list.c and therefore depend on the mupdf version
+	enum Command {
+		CMD_FILL_PATH,
+		CMD_STROKE_PATH,
+		CMD_CLIP_PATH,
+		CMD_CLIP_STROKE_PATH,
+		CMD_FILL_TEXT,
+		CMD_STROKE_TEXT,
+		CMD_CLIP_TEXT,
+		CMD_CLIP_STROKE_TEXT,
+		CMD_IGNORE_TEXT,
+		CMD_FILL_SHADE,
+		CMD_FILL_IMAGE,
+		CMD_FILL_IMAGE_MASK,
+		CMD_CLIP_IMAGE_MASK,
+		CMD_POP_CLIP,
+		CMD_BEGIN_MASK,
+		CMD_END_MASK,
+		CMD_BEGIN_GROUP,
+		CMD_END_GROUP,
+		CMD_BEGIN_TILE,
+		CMD_END_TILE,
+		CMD_RENDER_FLAGS,
+		CMD_DEFAULT_COLORSPACES,
+		CMD_BEGIN_LAYER,
+		CMD_END_LAYER,
+		CMD_BEGIN_STRUCTURE,
+		CMD_END_STRUCTURE,
+		CMD_BEGIN_METATEXT,
+		CMD_END_METATEXT
+	};
+
+	enum Colorspace {
+		CS_UNCHANGED,
+		CS_GRAY_0,
+		CS_GRAY_1,
+		CS_RGB_0,
+		CS_RGB_1,
+		CS_CMYK_0,
+		CS_CMYK_1,
+		CS_OTHER_0
+	};
+
+	enum Alpha {
+		ALPHA_UNCHANGED,
+		ALPHA_1,
+		ALPHA_0,
+		ALPHA_PRESENT
+	};
+
+	enum Ctm {
+		CTM_CHANGE_AD = 1,
+		CTM_CHANGE_BC = 2,
+		CTM_CHANGE_EF = 4
+	};
+
+	constexpr uint32_t LIST_MAGIC = 0x54534C44; // "DLST"
+	constexpr uint32_t LIST_VERSION = 1;
+
+	struct Header {
+		uint32_t magic = LIST_MAGIC;
+		uint32_t version = LIST_VERSION;
+		char mupdf_version[16] = {};
+		uint64_t node_size = sizeof(fz_display_node);
+		uint64_t pointer_size = sizeof(void*);
+
+		uint64_t content_hash = 0;
+		uint64_t page = 0;
+		fz_rect mediabox = {};
+
+		uint64_t amount_nodes = 0;
+		uint64_t amount_strokes = 0;
+		// FNV-1a over everything after the header
+		uint64_t checksum = 0;
+	};
+
+	struct Stroke {
+		// the position of the pointer in the list, in nodes
+		uint64_t slot = 0;
+		int32_t start_cap = 0;
+		int32_t dash_cap = 0;
+		int32_t end_cap = 0;
+		int32_t linejoin = 0;
+		float linewidth = 0;
+		float miterlimit = 0;
+		float dash_phase = 0;
+		int32_t dash_len = 0;
+		float dash_list[32] = {};
+	};
+
+	constexpr size_t size_in_nodes(size_t bytes) {
+		return (bytes + sizeof(fz_display_node) - 1) / sizeof(fz_display_node);
+	}
+
+	/// <summary>
+	/// Walks over the nodes of the list and collects the positions of the stroke state pointers
+	/// </summary>
+	/// <returns>False if the list contains a node which can not be stored</returns>
+	bool find_stroke_slots(const fz_display_node* nodes, size_t len, std::vector<size_t>& slots) {
+		size_t colorspace_n = 1;
+		size_t pos = 0;
+
+		while (pos < len) {
+			const auto& node = nodes[pos];
+			if (node.size == 0 or pos + node.size > len) {
+				return false;
+			}
+
+			switch (node.cmd) {
+			case CMD_FILL_PATH:
+			case CMD_STROKE_PATH:
+			case CMD_CLIP_PATH:
+			case CMD_CLIP_STROKE_PATH:
+			case CMD_POP_CLIP:
+			case CMD_END_GROUP:
+			case CMD_BEGIN_TILE:
+			case CMD_END_TILE:
+			case CMD_RENDER_FLAGS:
+			case CMD_BEGIN_LAYER:
+			case CMD_END_LAYER:
+			case CMD_BEGIN_STRUCTURE:
+			case CMD_END_STRUCTURE:
+			case CMD_BEGIN_METATEXT:
+			case CMD_END_METATEXT:
+				break;
+			default:
+				// the node references a font, an image, a shading or a colorspace
+				return false;
+			}
+
+			switch (node.cs) {
+			case CS_UNCHANGED:
+				break;
+			case CS_GRAY_0:
+			case CS_GRAY_1:
+				colorspace_n = 1;
+				break;
+			case CS_RGB_0:
+			case CS_RGB_1:
+				colorspace_n = 3;
+				break;
+			case CS_CMYK_0:
+			case CS_CMYK_1:
+				colorspace_n = 4;
+				break;
+			default:
+				return false;
+			}
+
+			// the data of a node is stored in this order right behind it
+			size_t offset = 1;
+			if (node.rect) {
+				offset += size_in_nodes(sizeof(fz_rect));
+			}
+			if (node.color) {
+				offset += size_in_nodes(colorspace_n * sizeof(float));
+			}
+			if (node.alpha == ALPHA_PRESENT) {
+				offset += size_in_nodes(sizeof(float));
+			}
+			if (node.ctm & CTM_CHANGE_AD) {
+				offset += size_in_nodes(2 * sizeof(float));
+			}
+			if (node.ctm & CTM_CHANGE_BC) {
+				offset += size_in_nodes(2 * sizeof(float));
+			}
+			if (node.ctm & CTM_CHANGE_EF) {
+				offset += size_in_nodes(2 * sizeof(float));
+			}
+			if (node.stroke) {
+				slots.push_back(pos + offset);
+				offset += size_in_nodes(sizeof(fz_stroke_state*));
+			}
+
+			if (offset > node.size) {
+				return false;
+			}
+
+			pos += node.size;
+		}
+
+		return pos == len;
+	}
+
+	std::string get_name(uint64_t content_hash, size_t page) {
+		char name[64];
+		std::snprintf(name, sizeof(name), "%016llx_%zu", static_cast<unsigned long long>(content_hash), page);
+		return name;
+	}
+
+	/// <summary>
+	/// Writes the list into the store, if it only consists of nodes that can be stored
+	/// </summary>
+	/// <returns>True if the list was stored</returns>
+	bool store(Docanto::DiskStore& disk, const fz_display_list* list, uint64_t content_hash, size_t page) {
+		std::vector<size_t> slots;
+		if (list == nullptr or !find_stroke_slots(list->list, list->len, slots)) {
+			return false;
+		}
+
+		// the stroke pointers are replaced by the stroke states themselves
+		std::vector<fz_display_node> nodes(list->list, list->list + list->len);
+		std::vector<Stroke> strokes;
+		strokes.reserve(slots.size());
+		for (auto slot : slots) {
+			const fz_stroke_state* state = nullptr;
+			std::memcpy(&state, &list->list[slot], sizeof(state));
+
+			// if the layout of list.c changed we would read garbage here
+			if (state == nullptr or state->refs <= 0 or state->dash_len < 0 or state->dash_len > 32 or !std::isfinite(state->linewidth)) {
+				return false;
+			}
+
+			Stroke s;
+			s.slot = slot;
+			s.start_cap = state->start_cap;
+			s.dash_cap = state->dash_cap;
+			s.end_cap = state->end_cap;
+			s.linejoin = state->linejoin;
+			s.linewidth = state->linewidth;
+			s.miterlimit = state->miterlimit;
+			s.dash_phase = state->dash_phase;
+			s.dash_len = state->dash_len;
+			for (int i = 0; i < state->dash_len; i++) {
+				s.dash_list[i] = state->dash_list[i];
+			}
+			strokes.push_back(s);
+
+			std::memset(&nodes.at(slot), 0, sizeof(fz_stroke_state*));
+		}
+
+		Header header;
+		std::strncpy(header.mupdf_version, FZ_VERSION, sizeof(header.mupdf_version) - 1);
+		header.content_hash = content_hash;
+		header.page = page;
+		header.mediabox = list->mediabox;
+		header.amount_nodes = nodes.size();
+		header.amount_strokes = strokes.size();
+
+		auto nodes_data = reinterpret_cast<const byte*>(nodes.data());
+		auto strokes_data = reinterpret_cast<const byte*>(strokes.data());
+		header.checksum = Docanto::File::hash(nodes_data, nodes.size() * sizeof(fz_display_node));
+		header.checksum = Docanto::File::hash(strokes_data, strokes.size() * sizeof(Stroke), header.checksum);
+
+		return disk.store(get_name(content_hash, page), {
+			{ reinterpret_cast<const byte*>(&header), sizeof(header) },
+			{ nodes_data, nodes.size() * sizeof(fz_display_node) },
+			{ strokes_data, strokes.size() * sizeof(Stroke) }
+		});
+	}
+
+	/// <summary>
+	/// Reads the list of the page from the store. Files which are broken or were written by
+	/// another version are removed.
+	/// </summary>
+	/// <returns>The list, or nullptr if the page has to be interpreted</returns>
+	fz_display_list* load(fz_context* ctx, Docanto::DiskStore& disk, uint64_t content_hash, size_t page) {
+		auto name = get_name(content_hash, page);
+		auto file = disk.load(name);
+		if (!file.has_value()) {
+			return nullptr;
+		}
+
+		Header header;
+		bool valid = file->size() >= sizeof(header);
+		if (valid) {
+			std::memcpy(&header, file->data(), sizeof(header));
+			header.mupdf_version[sizeof(header.mupdf_version) - 1] = '\0';
+
+			valid = header.magic == LIST_MAGIC and header.version == LIST_VERSION and
+				std::strcmp(header.mupdf_version, FZ_VERSION) == 0 and
+				header.node_size == sizeof(fz_display_node) and header.pointer_size == sizeof(void*) and
+				header.content_hash == content_hash and header.page == page and
+				file->size() == sizeof(header) + header.amount_nodes * sizeof(fz_display_node) + header.amount_strokes * sizeof(Stroke);
+		}
+
+		auto nodes = reinterpret_cast<const fz_display_node*>(file->data() + sizeof(header));
+		auto strokes_data = file->data() + sizeof(header) + header.amount_nodes * sizeof(fz_display_node);
+		std::vector<size_t> slots;
+
+		if (valid) {
+			auto checksum = Docanto::File::hash(file->data() + sizeof(header), file->size() - sizeof(header));
+			valid = checksum == header.checksum and
+				find_stroke_slots(nodes, header.amount_nodes, slots) and slots.size() == header.amount_strokes;
+		}
+
+		std::vector<Stroke> strokes(valid ? header.amount_strokes : 0);
+		if (valid) {
+			std::memcpy(strokes.data(), strokes_data, strokes.size() * sizeof(Stroke));
+			for (size_t i = 0; i < strokes.size() and valid; i++) {
+				valid = strokes.at(i).slot == slots.at(i) and strokes.at(i).dash_len >= 0 and strokes.at(i).dash_len <= 32;
+			}
+		}
+
+		if (!valid) {
+			file.reset();
+			disk.remove(name);
+			Docanto::Logger::warn("Removed the outdated display list of page ", page + 1);
+			return nullptr;
+		}
+
+		fz_display_list* list = nullptr;
+		fz_var(list);
+		fz_try(ctx) {
+			list = fz_new_display_list(ctx, header.mediabox);
+
+			size_t bytes = header.amount_nodes * sizeof(fz_display_node);
+			auto data = reinterpret_cast<fz_display_node*>(fz_malloc(ctx, bytes));
+			std::memcpy(data, nodes, bytes);
+			for (auto slot : slots) {
+				std::memset(&data[slot], 0, sizeof(fz_stroke_state*));
+			}
+
+			fz_free(ctx, list->list);
+			list->list = data;
+			list->max = header.amount_nodes;
+			list->len = header.amount_nodes;
+
+			// a list which is dropped halfway through will skip the stroke states which are still nullptr
+			for (size_t i = 0; i < strokes.size(); i++) {
+				const auto& s = strokes.at(i);
+				auto state = fz_new_stroke_state_with_dash_len(ctx, s.dash_len);
+				state->start_cap = static_cast<fz_linecap>(s.start_cap);
+				state->dash_cap = static_cast<fz_linecap>(s.dash_cap);
+				state->end_cap = static_cast<fz_linecap>(s.end_cap);
+				state->linejoin = static_cast<fz_linejoin>(s.linejoin);
+				state->linewidth = s.linewidth;
+				state->miterlimit = s.miterlimit;
+				state->dash_phase = s.dash_phase;
+				state->dash_len = s.dash_len;
+				for (int d = 0; d < s.dash_len; d++) {
+					state->dash_list[d] = s.dash_list[d];
+				}
+
+				std::memcpy(&data[s.slot], &state, sizeof(state));
+			}
+		} fz_catch(ctx) {
+			fz_drop_display_list(ctx, list);
+			list = nullptr;
+			Docanto::Logger::error("Could not load the display list of page ", page + 1);
+		}
+
+		return list;
+	}
+}
+
+Docanto::Image get_image_from_list(fz_context* ctx, const DisplayListWrapper* wrap, const Docanto::Geometry::Rectangle<float>& scissor, const float dpi, fz_cookie* cookie = nullptr, const Docanto::ImageTarget* target = nullptr);
+Docanto::Geometry::Dimension<size_t> get_tile_dims(const Docanto::Geometry::Rectangle<float>& scissor, const float dpi);
 
 class Docanto::PDFRenderer::RenderThreadManager {
-	bool m_should_worker_die = false;
+	std::atomic_bool m_should_worker_die = false;
 public:
 	enum class RenderStatus {
 		WAITING,
@@ -58,14 +474,15 @@ public:
 
 	enum class JobType {
 		RENDER_BITMAP,
-		LOAD_DISPLAY_LIST,
-		DELETE_DISPLAY_LIST
+		BUILD_DISPLAY_LIST,
+		LOAD_FROM_DISK
 	};
 
 	enum class ContentType {
 		CONTENT,
 		ANNOTATION,
-		WIDGET
+		WIDGET,
+		PREVIEW
 	};
 
 	struct RenderJob {
@@ -75,841 +492,2991 @@ public:
 		// For rendering jobs these information are needed
 		PDFRenderInfo info;
 		Geometry::Rectangle<float> chunk_rec;
-		RenderStatus status = RenderStatus::WAITING;
+		std::atomic<RenderStatus> status = RenderStatus::WAITING;
 		ContentType type = ContentType::CONTENT;
 		fz_cookie cookie = {};
 
-		// The list to copy
+		// lower values are rendered first
+		float priority = 0;
+
+		// the viewport generation the job was queued under. Once the generation of
+		// the renderer moves on the job is stale and will be dropped or aborted
+		std::atomic_size_t generation = 0;
+		std::shared_ptr<const std::atomic_size_t> renderer_generation = nullptr;
+
+		// prefetch jobs are queued ahead of the viewport and use the prefetch generation of the renderer
+		bool prefetch = false;
+
+		// The list which will be rendered. It is shared with all other jobs of the same page
 		std::shared_ptr<DisplayListWrapper> list = nullptr;
-		std::vector<std::thread::id> threads_already_copied;
 
 		// for debug only
 		std::thread::id render_id;
+		// how long the worker needed to render the bitmap
+		uint64_t render_us = 0;
+		// how long rendering the whole bitmap takes. For aborted jobs it is estimated from the progress of the cookie
+		uint64_t cost_us = 0;
+		// when the job was handed to the render threads on the clock of the ChromeTrace, -1 if it was not recorded
+		long long queued_us = -1;
+		// when the job was added to the queue of its document
+		std::chrono::steady_clock::time_point queued_at;
+		// the render time the document was charged with when the job was taken, it is corrected once the job is finished
+		double charged_us = 0;
+
+		bool is_stale() const {
+			return renderer_generation != nullptr and generation != *renderer_generation;
+		}
 	};
 
 	std::atomic_size_t m_last_id = 0;
 
 private:
-	std::vector<std::thread> m_render_worker;
-
-	// the queue needs to be synchronized using the below mutex!
-	std::deque<std::shared_ptr<RenderJob>> m_jobs;
-	std::mutex m_render_worker_queue_mutex;
-	std::condition_variable m_render_worker_queue_condition_var;
+	// jobs with a lower priority than this are needed for the viewport. The previews (10 and more) and the
+	// prefetched tiles (20 and more) are only rendered once no document has any viewport work left
+	static constexpr float BACKGROUND_PRIORITY = 10.0f;
+
+	// Every worker owns one queue. Jobs are distributed round robin and idle workers
+	// steal from the other queues, so the workers only contend for a lock when they
+	// run out of work. Each queue is a heap so the most urgent job is always taken first.
+	struct WorkerQueue {
+		std::vector<std::shared_ptr<RenderJob>> jobs;
+		std::mutex mutex;
+
+		// the priority of the most urgent job, infinity if the queue is empty. The workers read it without the lock
+		std::atomic<float> top_priority = std::numeric_limits<float>::infinity();
+
+		static bool less_urgent(const std::shared_ptr<RenderJob>& a, const std::shared_ptr<RenderJob>& b) {
+			return a->priority > b->priority;
+		}
 
-	std::map<size_t, std::function<void(PDFRenderInfo, Image&&)>> m_job_callback;
+		void push(std::shared_ptr<RenderJob> job) {
+			jobs.push_back(job);
+			std::push_heap(jobs.begin(), jobs.end(), less_urgent);
+			top_priority = jobs.front()->priority;
+		}
 
-	struct pair_hash {
-		inline std::size_t operator()(const std::tuple<size_t, size_t, ContentType>& v) const {
-			switch (std::get<2>(v)) {
-				case ContentType::CONTENT:		return std::get<0>(v)* 31 + std::get<1>(v);
-				case ContentType::ANNOTATION:	return std::get<0>(v)* 31 + std::get<1>(v) + 1;
-				case ContentType::WIDGET:		return std::get<0>(v)* 31 + std::get<1>(v) + 2;
-			}
-			return std::get<0>(v) * 31 + std::get<1>(v) + 7;
+		std::shared_ptr<RenderJob> pop() {
+			std::pop_heap(jobs.begin(), jobs.end(), less_urgent);
+			auto job = jobs.back();
+			jobs.pop_back();
+			top_priority = jobs.empty() ? std::numeric_limits<float>::infinity() : jobs.front()->priority;
+			return job;
 		}
 	};
-	std::unordered_set<std::tuple<size_t, size_t, ContentType>, pair_hash> m_display_list_cache;
 
-public:
-	void add_job(size_t id, std::shared_ptr<RenderJob> job) {
-		std::scoped_lock<std::mutex> lock(m_render_worker_queue_mutex);
-		job->callback_id = id;
+	// Every renderer has its own set of worker queues, so the jobs of one document can not crowd out the
+	// ones of the others. The document is chosen by its render time, the job by the worker queues.
+	struct DocumentQueue {
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		std::atomic_size_t next_queue = 0;
 
-		if (job->job == JobType::LOAD_DISPLAY_LIST ) {
-			m_display_list_cache.insert({ id, job->info.page, job->type });
-			m_jobs.push_back(job);
-		}
-		else if (job->job == JobType::DELETE_DISPLAY_LIST) {
-			if (m_display_list_cache.contains({ id, job->info.page, job->type })) {
-				m_display_list_cache.erase({ id, job->info.page, job->type });
-			}
-			else {
-				return;
+		// the render time the document used divided by its weight, in us
+		std::atomic<double> virtual_time = 0;
+		// how long a job of the document takes on average, in us
+		std::atomic<double> average_us = 1000;
+
+		// how long the jobs waited until a worker took them
+		PDFRenderStatistics::Histogram wait_us;
+
+		DocumentQueue(size_t amount_queues) {
+			for (size_t i = 0; i < std::max<size_t>(amount_queues, 1); i++) {
+				queues.push_back(std::make_unique<WorkerQueue>());
 			}
-			m_jobs.push_front(job);
 		}
-		else {
-			m_jobs.push_back(job);
+
+		/// <summary>
+		/// The priority of the most urgent job of all worker queues, infinity if there is none
+		/// </summary>
+		float get_top_priority() const {
+			float top = std::numeric_limits<float>::infinity();
+			for (const auto& queue : queues) {
+				top = std::min(top, queue->top_priority.load());
+			}
+			return top;
 		}
-		
-		m_render_worker_queue_condition_var.notify_one();
-	}
 
-	void set_callback(size_t id, std::function<void(PDFRenderInfo, Image&&)> f) {
-		m_job_callback[id] = f;
-	}
-	
-	bool has_display_list(size_t id, size_t page, ContentType type) {
-		return m_display_list_cache.contains({ id, page, type });
-	}
+		void push(std::shared_ptr<RenderJob> job) {
+			auto& queue = *queues.at(next_queue.fetch_add(1) % queues.size());
+			std::scoped_lock<std::mutex> lock(queue.mutex);
+			queue.push(job);
+		}
 
-	size_t get_amount_threads() {
-		return m_render_worker.size();
-	}
+		/// <summary>
+		/// Takes the most urgent job of the workers own queue, or steals one from the other queues. While the
+		/// document has work for its viewport the queues which only hold background work are skipped.
+		/// Finished and stale jobs which are encountered on the way are removed.
+		/// </summary>
+		/// <param name="contended">Set if a queue with work was skipped because another worker held it</param>
+		std::shared_ptr<RenderJob> pop(size_t worker, std::vector<std::shared_ptr<RenderJob>>& canceled, bool& contended) {
+			bool urgent = get_top_priority() < BACKGROUND_PRIORITY;
+			size_t amount_queues = queues.size();
+
+			for (size_t i = 0; i < amount_queues; i++) {
+				auto& queue = *queues.at((worker + i) % amount_queues);
+				float top = queue.top_priority;
+				if (std::isinf(top) or (urgent and top >= BACKGROUND_PRIORITY)) {
+					continue;
+				}
 
-	size_t remove_finished_jobs() {
-		std::scoped_lock<std::mutex> lock(m_render_worker_queue_mutex);
-		auto& queue = m_jobs;
-		size_t amount = 0;
+				// only the own queue is waited for
+				std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+				if (i == 0) {
+					lock.lock();
+				}
+				else if (!lock.try_lock()) {
+					contended = true;
+					continue;
+				}
 
-		for (auto it = queue.begin(); it != queue.end();) {
-			if ((*it)->status == RenderStatus::DONE or (*it)->threads_already_copied.size() == get_amount_threads()) {
-				(*it)->status = RenderStatus::DONE;
-				queue.erase(it);
-				amount++;
-				it = queue.begin();
-			}
-			else {
-				it++;
+				while (!queue.jobs.empty()) {
+					auto job = queue.pop();
+					if (claim_job(job, canceled)) {
+						return job;
+					}
+				}
 			}
-		}
-
-		return amount;
-	}
 
-	void async_render() {
-		Timer start;
-		fz_context* ctx;
-		{
-			auto c = GlobalPDFContext::get_instance().get();
-			ctx = fz_clone_context(*c);
+			return nullptr;
 		}
+	};
 
-		auto copy_list = [ctx](fz_display_list* list) {
-			fz_display_list* ls = fz_new_display_list(ctx, (list)->mediabox);
-			ls->len = (list)->len;
-			ls->max = (list)->max;
-			ls->list = new fz_display_node[ls->max];
-			memcpy(ls->list, (list)->list, (list)->len * sizeof(fz_display_node));
-			return ls;
-			};
+	std::map<size_t, std::unique_ptr<DocumentQueue>> m_documents;
+	// the map is only written when a renderer is added or removed, the queues have their own locks
+	std::shared_mutex m_documents_mutex;
 
-		auto delete_list = [ctx](fz_display_list* list) {
-			delete[] list->list;
-			list->list = nullptr;
-			list->len = 0;
-			list->max = 0;
-			fz_drop_display_list(ctx, list);
-			};
+	// the id of the renderer the user works with, 0 if there is none
+	std::atomic_size_t m_active_document = 0;
 
-		std::map<std::tuple<size_t, size_t, ContentType>, fz_display_list*> t_content_list;
-		
-		Docanto::Logger::log("Initialized render thread in ", start);
-		auto local_thread_id = std::this_thread::get_id();
+	std::vector<std::thread> m_render_worker;
 
-		while (!m_should_worker_die) {
-			// wait until a signal is received
-			std::unique_lock<std::mutex> lock(m_render_worker_queue_mutex);
-			m_render_worker_queue_condition_var.wait(lock, [this] {
-				return m_should_worker_die or m_jobs.size() != 0;
-			});
+	// idle workers sleep on this until a new job is added
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_sleep_condition_var;
+	size_t m_job_signal = 0;
 
-			// get a job
-			std::shared_ptr<RenderJob> current_job = nullptr;
-			auto& queue = m_jobs;
-			for (size_t i = 0; i < queue.size(); i++) {
-				auto& job = queue.at(i);
-				
-				if (job->job == JobType::LOAD_DISPLAY_LIST) {
-					// check if the job was once completed by this thread
-					if (std::find(job->threads_already_copied.begin(), job->threads_already_copied.end(), local_thread_id) != job->threads_already_copied.end()
-						// or check if the display list already exist
-						or t_content_list.contains({ job->callback_id, job->info.page, job->type })) {
-						continue;
-					}
-					//Docanto::Logger::log("Loading list page ", job->info.page);
-					current_job = job;
-					break;
-				}
+	// the callbacks are called from the workers, the read lock is held while they are running
+	std::map<size_t, std::function<void(PDFRenderInfo, Image&&, uint64_t)>> m_job_callback;
+	std::map<size_t, std::function<void(PDFRenderInfo, JobType, uint64_t)>> m_cancel_callback;
+	std::map<size_t, std::function<void(PDFRenderInfo, fz_context*, fz_cookie*)>> m_build_callback;
+	std::map<size_t, std::function<void(PDFRenderInfo)>> m_load_callback;
+	std::map<size_t, std::function<std::optional<ImageTarget>(PDFRenderInfo, const Geometry::Dimension<size_t>&)>> m_target_callback;
+	std::shared_mutex m_callback_mutex;
 
-				if (job->job == JobType::DELETE_DISPLAY_LIST) {
-					// check if the thread already handled it
-					if (std::find(job->threads_already_copied.begin(), job->threads_already_copied.end(), local_thread_id) != job->threads_already_copied.end() 
-						// or the list was already deleted at sometime. we cannot delete the same list twice
-						or !t_content_list.contains({ job->callback_id, job->info.page, job->type })) {
-						continue;
-					}
-					current_job = job;
-					//Docanto::Logger::log("Deleting list page ", job->info.page);
-					break;
-				}
+	// the jobs which are currently rendered, one slot per worker
+	std::vector<std::shared_ptr<RenderJob>> m_running_jobs;
+	std::mutex m_running_jobs_mutex;
 
-				// accept any jobs that are currently in the queue
-				if (job->job == JobType::RENDER_BITMAP and job->status == RenderStatus::WAITING) {
-					// first check if the job was aborted
-					if (job->cookie.abort == 1) {
-						job->status = RenderStatus::DONE;
-						continue;
-					}
+	void signal_workers(bool all) {
+		{
+			std::scoped_lock<std::mutex> lock(m_sleep_mutex);
+			m_job_signal++;
+		}
 
-					// second check if the thread does have the methods to render the bitmap
-					if (!t_content_list.contains({ job->callback_id, job->info.page, job->type })) {
-						// if it doesnt we continue
-						continue;
-					}
+		if (all) {
+			m_sleep_condition_var.notify_all();
+		}
+		else {
+			m_sleep_condition_var.notify_one();
+		}
+	}
 
-					job->status = RenderStatus::PROCESSING;
-					job->render_id = std::this_thread::get_id();
-					// we need to safe the pointer since we cannot retrieve it later without being const
-					current_job = job;
-					//Docanto::Logger::log("Accepting job ", job->info.id);
-					break;
-				}
+	/// <summary>
+	/// Tries to claim the job for rendering. Jobs which are stale or were aborted are marked as
+	/// canceled and added to the given list, so the renderer can be notified once no queue is locked.
+	/// </summary>
+	/// <returns>True if the job was claimed by the calling worker</returns>
+	static bool claim_job(std::shared_ptr<RenderJob>& job, std::vector<std::shared_ptr<RenderJob>>& canceled) {
+		auto expected = RenderStatus::WAITING;
+
+		if (job->is_stale() or job->cookie.abort == 1) {
+			if (job->status.compare_exchange_strong(expected, RenderStatus::CANCELD)) {
+				canceled.push_back(job);
 			}
+			return false;
+		}
 
-			// unlock
-			lock.unlock();
+		return job->status.compare_exchange_strong(expected, RenderStatus::PROCESSING);
+	}
 
-			// we didnt find any rendering jobs and we can go back to waiting
-			if (current_job == nullptr) {
-				remove_finished_jobs();
-				continue;
-			}
+	/// <summary>
+	/// Changes the value without a lock, the other workers may change it at the same time
+	/// </summary>
+	template<typename F>
+	static void update_atomic(std::atomic<double>& value, F f) {
+		double current = value.load();
+		while (!value.compare_exchange_weak(current, f(current))) {}
+	}
 
-			if (current_job->job == JobType::RENDER_BITMAP) {
-				auto list = t_content_list[{current_job->callback_id, current_job->info.page, current_job->type}];
-				auto cont_img = get_image_from_list(ctx, list, current_job->chunk_rec, current_job->info.dpi, &(current_job->cookie));
-						
-				// we have to check if the rendering was aborted
-				if (current_job->cookie.abort) {
-					current_job->status = RenderStatus::DONE;
+	float get_weight(size_t id) const {
+		return id == m_active_document ? std::max(PDFRenderer::active_boost.load(), 1.0f) : 1.0f;
+	}
+
+	/// <summary>
+	/// Takes the most urgent job of the document which is the furthest behind its share of the render time.
+	/// Documents with jobs for their viewport always come before the ones which only have background work.
+	/// </summary>
+	std::shared_ptr<RenderJob> pop_job(size_t worker, std::vector<std::shared_ptr<RenderJob>>& canceled) {
+		std::shared_lock<std::shared_mutex> lock(m_documents_mutex);
+
+		while (true) {
+			size_t best_id = 0;
+			DocumentQueue* best = nullptr;
+			bool best_urgent = false;
+			double best_time = 0;
+
+			for (const auto& [id, queue] : m_documents) {
+				float top = queue->get_top_priority();
+				if (std::isinf(top)) {
 					continue;
 				}
-				
 
-				if (m_job_callback.contains(current_job->callback_id)) {
-					m_job_callback[current_job->callback_id](current_job->info, std::move(cont_img));
+				bool urgent = top < BACKGROUND_PRIORITY;
+				double time = queue->virtual_time;
+				if (best == nullptr or (urgent and !best_urgent) or (urgent == best_urgent and time < best_time)) {
+					best_id = id;
+					best = queue.get();
+					best_urgent = urgent;
+					best_time = time;
 				}
-				
-				current_job->status = RenderStatus::DONE;
-				continue;
 			}
 
-			if (current_job->job == JobType::LOAD_DISPLAY_LIST) {
-				t_content_list[{current_job->callback_id, current_job->info.page, current_job->type}] = copy_list(*(current_job->list->get().get()));
-				lock.lock();
-				current_job->threads_already_copied.push_back(local_thread_id);;
-				lock.unlock();
-				continue;
+			if (best == nullptr) {
+				return nullptr;
 			}
 
-			if (current_job->job == JobType::DELETE_DISPLAY_LIST) {
-				if (!t_content_list.contains({ current_job->callback_id, current_job->info.page, current_job->type }))
-					continue;
-
-				delete_list(t_content_list[{current_job->callback_id, current_job->info.page, current_job->type}]);
-				t_content_list.erase({ current_job->callback_id, current_job->info.page, current_job->type });
-
-				lock.lock();
-				current_job->threads_already_copied.push_back(local_thread_id);
-				lock.unlock();
+			bool contended = false;
+			auto job = best->pop(worker, canceled, contended);
+			if (job == nullptr) {
+				// the queues only held stale jobs or were busy, so the documents are looked at again
+				if (contended) {
+					std::this_thread::yield();
+				}
+				continue;
 			}
-			
-		}
 
-		for (auto& [_,list] : t_content_list) {
-			delete_list(list);
+			// the job is paid for in advance, so the other workers see it right away
+			job->charged_us = best->average_us;
+			double charged = job->charged_us / get_weight(best_id);
+			update_atomic(best->virtual_time, [charged](double time) { return time + charged; });
+			best->wait_us.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job->queued_at).count());
+			return job;
 		}
-
-		fz_drop_context(ctx);
 	}
 
-	RenderThreadManager() {
-		// add two threads for now
-		m_render_worker.push_back(std::thread([this] { async_render(); }));
-		m_render_worker.push_back(std::thread([this] { async_render(); }));
+	/// <summary>
+	/// Replaces the estimated cost the document was charged with by the time the job actually took
+	/// </summary>
+	void settle_job(const RenderJob& job, uint64_t used_us) {
+		std::shared_lock<std::shared_mutex> lock(m_documents_mutex);
+		auto it = m_documents.find(job.callback_id);
+		if (it == m_documents.end()) {
+			return;
+		}
+
+		auto& queue = *it->second;
+		double correction = (used_us - job.charged_us) / get_weight(job.callback_id);
+		update_atomic(queue.virtual_time, [correction](double time) { return time + correction; });
+		update_atomic(queue.average_us, [used_us](double average) { return average * 0.9 + used_us * 0.1; });
 	}
 
-	~RenderThreadManager() {
-		m_should_worker_die = true;
-		m_render_worker_queue_condition_var.notify_all();
+	void notify_canceled(std::vector<std::shared_ptr<RenderJob>>& canceled) {
+		if (canceled.empty()) {
+			return;
+		}
 
-		for (auto& thread : m_render_worker) {
-			thread.join();
+		std::shared_lock<std::shared_mutex> lock(m_callback_mutex);
+		for (auto& job : canceled) {
+			auto it = m_cancel_callback.find(job->callback_id);
+			if (it != m_cancel_callback.end()) {
+				it->second(job->info, job->job, job->cost_us);
+			}
 		}
+		canceled.clear();
 	}
-};
 
+public:
+	void add_job(size_t id, std::shared_ptr<RenderJob> job) {
+		std::vector<std::shared_ptr<RenderJob>> jobs = { job };
+		add_jobs(id, jobs);
+	}
 
-struct Docanto::PDFRenderer::impl {
-	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_content;
-	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_widgets;
-	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_annotat;
-	std::vector<Geometry::Point<float>> m_page_pos;
+	/// <summary>
+	/// Adds multiple jobs to the queues of the renderer at once. The jobs are dealt out in the order of
+	/// their priority so that the most urgent jobs end up at the top of different queues.
+	/// </summary>
+	void add_jobs(size_t id, std::vector<std::shared_ptr<RenderJob>>& jobs) {
+		if (jobs.empty()) {
+			return;
+		}
 
-	ThreadSafeVector<PDFRenderInfo> m_previewbitmaps;
-	ThreadSafeVector<PDFRenderInfo> m_highDefBitmaps;
-	ThreadSafeVector<PDFRenderInfo> m_annotationBitmaps;
+		std::sort(jobs.begin(), jobs.end(), [](const auto& a, const auto& b) {
+			return a->priority < b->priority;
+		});
 
-	// the queue needs to be synchronized using the below mutex!
-	ThreadSafeWrapper<std::deque<std::shared_ptr<RenderThreadManager::RenderJob>>> m_jobs;
+		{
+			std::shared_lock<std::shared_mutex> lock(m_documents_mutex);
+			auto it = m_documents.find(id);
+			if (it == m_documents.end()) {
+				Docanto::Logger::error("No render queue exists for the renderer ", id);
+				return;
+			}
 
-	Geometry::Rectangle<float> m_current_viewport;
-	float m_current_dpi = 92;
+			auto& queue = *it->second;
 
-	impl() = default;
-	~impl() = default;
-};
+			// a document which was idle starts at the time of the busiest ones, else it could use up all the
+			// time it did not need in the meantime
+			if (std::isinf(queue.get_top_priority())) {
+				double start = std::numeric_limits<double>::infinity();
+				for (const auto& [other_id, other] : m_documents) {
+					if (other_id != id and !std::isinf(other->get_top_priority())) {
+						start = std::min(start, other->virtual_time.load());
+					}
+				}
+				if (!std::isinf(start)) {
+					update_atomic(queue.virtual_time, [start](double time) { return std::max(time, start); });
+				}
+			}
 
+			auto now = std::chrono::steady_clock::now();
+			for (auto& job : jobs) {
+				job->callback_id = id;
+				job->queued_at = now;
+				queue.push(job);
+			}
+		}
 
+		signal_workers(jobs.size() > 1);
+	}
 
-std::unique_ptr<Docanto::PDFRenderer::RenderThreadManager> Docanto::PDFRenderer::thread_manager = nullptr;
+	/// <summary>
+	/// Sets the renderer the user works with. Its jobs get a larger share of the render threads
+	/// </summary>
+	/// <param name="id">The id of the renderer, 0 if no document is active</param>
+	void set_active(size_t id) {
+		m_active_document = id;
+	}
 
-size_t Docanto::PDFRenderer::tread_manager_count = 0;
-size_t Docanto::PDFRenderer::last_id = 1;
+	void clear_active(size_t id) {
+		m_active_document.compare_exchange_strong(id, 0);
+	}
 
-Docanto::PDFRenderer::PDFRenderer(std::shared_ptr<PDF> pdf_obj, std::shared_ptr<IPDFRenderImageProcessor> processor) : pimpl(std::make_unique<impl>()) {
-	if (thread_manager == nullptr) {
-		thread_manager = std::make_unique<RenderThreadManager>();
-		tread_manager_count++;
+	bool is_active(size_t id) const {
+		return m_active_document == id;
 	}
 
-	id = last_id++;
+	/// <summary>
+	/// Fills in the queue of the renderer
+	/// </summary>
+	void get_statistics(size_t id, PDFRenderStatistics::Snapshot& snapshot) {
+		std::shared_lock<std::shared_mutex> lock(m_documents_mutex);
+		auto it = m_documents.find(id);
+		if (it == m_documents.end()) {
+			return;
+		}
 
-	this->pdf_obj = pdf_obj;
-	this->m_processor = processor;
+		snapshot.queue_wait_us = it->second->wait_us.snapshot();
+		snapshot.schedule_weight = get_weight(id);
+		snapshot.active = is_active(id);
+	}
 
-	thread_manager->set_callback(id, [&](PDFRenderInfo info, Image&& i) {receive_image(info, std::move(i)); });
+	void set_callback(size_t id, std::function<void(PDFRenderInfo, Image&&, uint64_t)> f, std::function<void(PDFRenderInfo, JobType, uint64_t)> cancel, std::function<void(PDFRenderInfo, fz_context*, fz_cookie*)> build,
+		std::function<void(PDFRenderInfo)> load, std::function<std::optional<ImageTarget>(PDFRenderInfo, const Geometry::Dimension<size_t>&)> target) {
+		{
+			std::unique_lock<std::shared_mutex> lock(m_documents_mutex);
+			m_documents.try_emplace(id, std::make_unique<DocumentQueue>(m_render_worker.size()));
+		}
 
-	position_pdfs();
-	//create_preview();
-	update();
+		std::unique_lock<std::shared_mutex> lock(m_callback_mutex);
+		m_job_callback[id] = f;
+		m_cancel_callback[id] = cancel;
+		m_build_callback[id] = build;
+		m_load_callback[id] = load;
+		m_target_callback[id] = target;
+	}
 
-}
+	void remove_callback(size_t id) {
+		// the jobs which are still queued are dropped without notifying the renderer
+		{
+			std::unique_lock<std::shared_mutex> lock(m_documents_mutex);
+			m_documents.erase(id);
+		}
+		clear_active(id);
+
+		std::unique_lock<std::shared_mutex> lock(m_callback_mutex);
+		m_job_callback.erase(id);
+		m_cancel_callback.erase(id);
+		m_build_callback.erase(id);
+		m_load_callback.erase(id);
+		m_target_callback.erase(id);
+	}
 
-Docanto::PDFRenderer::~PDFRenderer() {
-	tread_manager_count--;
+	/// <summary>
+	/// Aborts the jobs which are currently rendered but became stale. This only has to look at one
+	/// job per worker, the stale jobs that are still queued are dropped once a worker reaches them.
+	/// </summary>
+	/// <returns>The amount of aborted jobs</returns>
+	size_t abort_stale_jobs() {
+		std::scoped_lock<std::mutex> lock(m_running_jobs_mutex);
+		size_t amount = 0;
 
-	if (tread_manager_count == 0) {
-		thread_manager.reset();
+		for (auto& job : m_running_jobs) {
+			if (job != nullptr and job->is_stale()) {
+				job->cookie.abort = 1;
+				amount++;
+			}
+		}
+
+		return amount;
+	}
+	
+	size_t get_amount_threads() {
+		return m_render_worker.size();
+	}
+
+	void async_render(size_t worker) {
+		Timer start;
+		fz_context* ctx;
+		{
+			auto c = GlobalPDFContext::get_instance().get();
+			ctx = fz_clone_context(*c);
+		}
+
+		Docanto::Logger::log("Initialized render thread in ", start);
+		std::vector<std::shared_ptr<RenderJob>> canceled;
+		auto& trace = ChromeTrace::get_instance();
+		trace.set_thread_name("Render worker " + std::to_string(worker));
+
+		while (!m_should_worker_die) {
+			size_t signal = 0;
+			{
+				std::scoped_lock<std::mutex> lock(m_sleep_mutex);
+				signal = m_job_signal;
+			}
+
+			std::shared_ptr<RenderJob> current_job = pop_job(worker, canceled);
+			notify_canceled(canceled);
+
+			// we didnt find any jobs and we can go back to waiting until a new one is added
+			if (current_job == nullptr) {
+				std::unique_lock<std::mutex> lock(m_sleep_mutex);
+				m_sleep_condition_var.wait(lock, [this, signal] {
+					return m_should_worker_die or m_job_signal != signal;
+				});
+				continue;
+			}
+
+			if (current_job->queued_us >= 0) {
+				trace.add_async_span("queue wait", "queue", current_job->info.id, current_job->queued_us, trace.now_us(),
+					{ { "page", static_cast<double>(current_job->info.page) }, { "priority", current_job->priority } });
+			}
+
+			if (current_job->job == JobType::RENDER_BITMAP) {
+				current_job->render_id = std::this_thread::get_id();
+				{
+					std::scoped_lock<std::mutex> lock(m_running_jobs_mutex);
+					m_running_jobs.at(worker) = current_job;
+				}
+
+				// the processor may want the tile drawn straight into its own buffer
+				std::optional<ImageTarget> target;
+				{
+					std::shared_lock<std::shared_mutex> lock(m_callback_mutex);
+					auto it = m_target_callback.find(current_job->callback_id);
+					if (it != m_target_callback.end()) {
+						target = it->second(current_job->info, get_tile_dims(current_job->chunk_rec, current_job->info.dpi));
+					}
+				}
+
+				Image cont_img;
+				{
+					const auto& key = current_job->info.key;
+					ChromeTrace::Span span("render tile");
+					span.arg("page", static_cast<double>(key.page)).arg("x", static_cast<double>(key.x)).arg("y", static_cast<double>(key.y))
+						.arg("level", static_cast<double>(key.level)).arg("dpi", current_job->info.dpi).arg("layer", static_cast<double>(key.layer));
+
+					Timer render_time;
+					cont_img = get_image_from_list(ctx, current_job->list.get(), current_job->chunk_rec, current_job->info.dpi, &(current_job->cookie), target.has_value() ? &target.value() : nullptr);
+					current_job->render_us = render_time.delta_us();
+					current_job->cost_us = current_job->render_us;
+				}
+				settle_job(*current_job, current_job->render_us);
+
+				{
+					std::scoped_lock<std::mutex> lock(m_running_jobs_mutex);
+					m_running_jobs.at(worker) = nullptr;
+				}
+						
+				// we have to check if the rendering was aborted
+				if (current_job->cookie.abort) {
+					// the content is a single list, so the cookie tells how much of the tile was done
+					const auto& cookie = current_job->cookie;
+					if (current_job->type == ContentType::CONTENT and cookie.progress > 0 and cookie.progress_max > static_cast<size_t>(cookie.progress)) {
+						current_job->cost_us = current_job->render_us * cookie.progress_max / static_cast<size_t>(cookie.progress);
+					}
+					else {
+						current_job->cost_us = 0;
+					}
+					current_job->status = RenderStatus::CANCELD;
+					canceled.push_back(current_job);
+					notify_canceled(canceled);
+					continue;
+				}
+				
+				{
+					std::shared_lock<std::shared_mutex> lock(m_callback_mutex);
+					auto it = m_job_callback.find(current_job->callback_id);
+					if (it != m_job_callback.end()) {
+						it->second(current_job->info, std::move(cont_img), current_job->cost_us);
+					}
+				}
+				
+				current_job->status = RenderStatus::DONE;
+			}
+			else if (current_job->job == JobType::BUILD_DISPLAY_LIST) {
+				// the renderer builds the lists with our context. The read lock keeps it alive while doing so
+				Timer build_time;
+				{
+					ChromeTrace::Span span("build display list");
+					span.arg("page", static_cast<double>(current_job->info.page));
+
+					std::shared_lock<std::shared_mutex> lock(m_callback_mutex);
+					auto it = m_build_callback.find(current_job->callback_id);
+					if (it != m_build_callback.end()) {
+						it->second(current_job->info, ctx, &(current_job->cookie));
+					}
+				}
+				settle_job(*current_job, build_time.delta_us());
+
+				current_job->status = RenderStatus::DONE;
+			}
+			else if (current_job->job == JobType::LOAD_FROM_DISK) {
+				// the renderer reads the tile and hands it to its processor itself
+				Timer load_time;
+				{
+					ChromeTrace::Span span("load tile");
+					span.arg("page", static_cast<double>(current_job->info.page));
+
+					std::shared_lock<std::shared_mutex> lock(m_callback_mutex);
+					auto it = m_load_callback.find(current_job->callback_id);
+					if (it != m_load_callback.end()) {
+						it->second(current_job->info);
+					}
+				}
+				settle_job(*current_job, load_time.delta_us());
+
+				current_job->status = RenderStatus::DONE;
+			}
+		}
+
+		fz_drop_context(ctx);
+	}
+
+	RenderThreadManager(size_t amount_threads) {
+		if (amount_threads == 0) {
+			amount_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		m_running_jobs.resize(amount_threads);
+
+		for (size_t i = 0; i < amount_threads; i++) {
+			m_render_worker.push_back(std::thread([this, i] { async_render(i); }));
+		}
+
+		Docanto::Logger::log("Started ", amount_threads, " render threads");
+	}
+
+	~RenderThreadManager() {
+		m_should_worker_die = true;
+		signal_workers(true);
+
+		for (auto& thread : m_render_worker) {
+			thread.join();
+		}
+	}
+};
+
+
+struct PageDisplayLists {
+	std::shared_ptr<DisplayListWrapper> content;
+	std::shared_ptr<DisplayListWrapper> widgets;
+	std::shared_ptr<DisplayListWrapper> annotat;
+};
+
+enum PageLayer {
+	PAGE_LAYER_CONTENT = 1,
+	PAGE_LAYER_WIDGETS = 2,
+	PAGE_LAYER_ANNOTATIONS = 4,
+	PAGE_LAYER_ALL = PAGE_LAYER_CONTENT | PAGE_LAYER_WIDGETS | PAGE_LAYER_ANNOTATIONS
+};
+
+std::optional<PageDisplayLists> record_page_lists(fz_context* ctx, fz_document* doc, size_t page, int layers, fz_cookie* cookie = nullptr);
+std::optional<PageDisplayLists> build_page_lists(fz_context* ctx, Docanto::PDF& pdf, size_t page, fz_cookie* cookie = nullptr);
+float get_tile_priority(const Docanto::Geometry::Rectangle<float>& viewport, const Docanto::Geometry::Rectangle<float>& page_rec, const Docanto::Geometry::Rectangle<float>& tile_rec, bool annotation);
+
+struct Docanto::PDFRenderer::impl {
+	// the display lists are built on demand, pages without lists hold a nullptr
+	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_content;
+	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_widgets;
+	ThreadSafeVector<std::shared_ptr<DisplayListWrapper>> m_page_annotat;
+	std::vector<Geometry::Point<float>> m_page_pos;
+	// the size of every page, the render threads need it without locking the context
+	std::vector<Geometry::Dimension<float>> m_page_dims;
+
+	ThreadSafeVector<PDFRenderInfo> m_previewbitmaps;
+	ThreadSafeVector<PDFRenderInfo> m_highDefBitmaps;
+	ThreadSafeVector<PDFRenderInfo> m_annotationBitmaps;
+
+	enum class ListState {
+		MISSING,
+		QUEUED,
+		READY,
+		FAILED
+	};
+
+	// the measured render time per pixel in the regions of a page
+	struct CostGrid {
+		static constexpr size_t SIZE = 16;
+		// 0 if the region was never measured
+		std::array<float, SIZE * SIZE> us_per_pixel = {};
+
+		template<typename F>
+		void for_cells(const Geometry::Rectangle<float>& rec, const Geometry::Dimension<float>& dims, F&& f) const {
+			Geometry::Dimension<float> cell = { dims.width / SIZE, dims.height / SIZE };
+			auto to_cell = [](float v, float cell) {
+				return static_cast<size_t>(std::clamp(v / cell, 0.0f, static_cast<float>(SIZE)));
+			};
+
+			for (size_t y = to_cell(rec.y, cell.height); y < std::min(to_cell(rec.bottom(), cell.height) + 1, SIZE); y++) {
+				for (size_t x = to_cell(rec.x, cell.width); x < std::min(to_cell(rec.right(), cell.width) + 1, SIZE); x++) {
+					auto overlap = rec.intersection({ x * cell.width, y * cell.height, cell.width, cell.height });
+					if (overlap.width > 0 and overlap.height > 0) {
+						f(y * SIZE + x, overlap.width * overlap.height);
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Adds a measurement of a tile to every region it covers. The cost of the tile is spread evenly over its area
+		/// </summary>
+		void add(const Geometry::Rectangle<float>& rec, const Geometry::Dimension<float>& dims, float cost) {
+			for_cells(rec, dims, [&](size_t i, float) {
+				auto& c = us_per_pixel.at(i);
+				c = c == 0 ? cost : (c + cost) / 2;
+			});
+		}
+
+		/// <summary>
+		/// Calculates the average cost over the area of the rectangle
+		/// </summary>
+		/// <param name="prior">The cost of the regions which were never measured</param>
+		float estimate(const Geometry::Rectangle<float>& rec, const Geometry::Dimension<float>& dims, float prior) const {
+			float sum = 0;
+			float area = 0;
+			for_cells(rec, dims, [&](size_t i, float a) {
+				auto c = us_per_pixel.at(i);
+				sum += (c == 0 ? prior : c) * a;
+				area += a;
+			});
+			return area > 0 ? sum / area : prior;
+		}
+	};
+
+	// how the cells of a block of 2x2 tiles are rendered
+	struct BlockLayout {
+		// the four cells are rendered as one tile of the coarser level at the same dpi
+		bool merged = false;
+		// how often each cell is split into four tiles at the same dpi, in the order upper left, upper right, lower left, lower right
+		std::array<size_t, 4> depth = {};
+		// the revision of the costs the layout was made with
+		size_t revision = 0;
+	};
+
+	// the drawn bitmaps and queued jobs of one page, mapped by their tile
+	struct PageTiles {
+		std::unordered_map<PDFTileCache::TileKey, PDFRenderInfo, PDFTileCache::TileKeyHash> bitmaps;
+		std::unordered_map<PDFTileCache::TileKey, std::shared_ptr<RenderThreadManager::RenderJob>, PDFTileCache::TileKeyHash> jobs;
+
+		// the low resolution preview of the whole page
+		std::optional<PDFRenderInfo> preview;
+		size_t preview_bytes = 0;
+
+		// the level the viewport was rendered at on the last request
+		std::optional<size_t> level;
+
+		// the measured costs of the content and the annotation layer
+		std::array<CostGrid, 2> costs;
+		// increased with every measurement
+		size_t cost_revision = 0;
+		// the layouts of the blocks of every grid, mapped by the zoom of the grid and the index of the block
+		std::unordered_map<size_t, std::unordered_map<size_t, BlockLayout>> layouts;
+
+		ListState list_state = ListState::MISSING;
+		std::shared_ptr<RenderThreadManager::RenderJob> list_job;
+
+		// increased every time the annotation layer is published
+		size_t annot_revision = 0;
+		// the revision of the annotation layer when the list job was queued
+		size_t list_annot_revision = 0;
+	};
+
+	struct TileIndex {
+		// all jobs which were queued and not yet received, mapped by their id
+		std::map<size_t, std::shared_ptr<RenderThreadManager::RenderJob>> jobs;
+		// the jobs which render into a target of the processor. It has to be committed or canceled
+		std::map<size_t, ImageTarget::PixelFormat> targets;
+		std::vector<PageTiles> pages;
+
+		void add_job(const std::shared_ptr<RenderThreadManager::RenderJob>& job) {
+			jobs[job->info.id] = job;
+			pages.at(job->info.page).jobs[job->info.key] = job;
+		}
+
+		void remove_job(size_t job_id) {
+			auto it = jobs.find(job_id);
+			if (it == jobs.end()) {
+				return;
+			}
+
+			// the tile may already belong to a newer job
+			auto& page_jobs = pages.at(it->second->info.page).jobs;
+			auto tile = page_jobs.find(it->second->info.key);
+			if (tile != page_jobs.end() and tile->second == it->second) {
+				page_jobs.erase(tile);
+			}
+
+			jobs.erase(it);
+		}
+
+		void add_bitmap(const PDFRenderInfo& info) {
+			pages.at(info.page).bitmaps[info.key] = info;
+		}
+
+		void remove_bitmap(const PDFRenderInfo& info) {
+			auto& page_bitmaps = pages.at(info.page).bitmaps;
+			auto tile = page_bitmaps.find(info.key);
+			if (tile != page_bitmaps.end() and tile->second.id == info.id) {
+				page_bitmaps.erase(tile);
+			}
+		}
+	};
+
+	// Culling only has to look at the tiles of the visible pages. The index has to be locked
+	// before any of the bitmap lists!
+	ThreadSafeWrapper<TileIndex> m_tiles;
+
+	// the four tiles of the next finer level which lie on a tile, each at half its resolution
+	struct MipTile {
+		// the quadrants in the order upper left, upper right, lower left, lower right
+		std::array<Image, 4> quadrants;
+		// the area of the page each quadrant covers
+		std::array<Geometry::Rectangle<float>, 4> recs;
+		float dpi = 0;
+		size_t bytes = 0;
+		std::list<PDFTileCache::TileKey>::iterator lru;
+	};
+
+	// Keeps the downsampled tiles until the budget is exceeded, the least recently used ones are removed
+	// first. It has to be locked after the index!
+	struct MipStore {
+		std::unordered_map<PDFTileCache::TileKey, MipTile, PDFTileCache::TileKeyHash> tiles;
+		// the most recently used tile is in front
+		std::list<PDFTileCache::TileKey> lru;
+		size_t bytes = 0;
+		size_t budget = 32 * 1024 * 1024;
+
+		void insert(const PDFTileCache::TileKey& key, size_t quadrant, const Geometry::Rectangle<float>& rec, float dpi, Image&& img) {
+			auto [it, inserted] = tiles.try_emplace(key);
+			auto& tile = it->second;
+			if (inserted) {
+				lru.push_front(key);
+				tile.lru = lru.begin();
+			}
+			else {
+				lru.splice(lru.begin(), lru, tile.lru);
+			}
+
+			// the quadrants of another dpi can not be put together
+			if (!FLOAT_EQUAL(tile.dpi, dpi)) {
+				for (auto& q : tile.quadrants) {
+					q = Image();
+				}
+				bytes -= tile.bytes;
+				tile.bytes = 0;
+				tile.dpi = dpi;
+			}
+
+			auto& q = tile.quadrants.at(quadrant);
+			tile.bytes -= q.size;
+			bytes -= q.size;
+			tile.bytes += img.size;
+			bytes += img.size;
+
+			q = std::move(img);
+			tile.recs.at(quadrant) = rec;
+			evict();
+		}
+
+		/// <summary>
+		/// Puts the quadrants of the tile together
+		/// </summary>
+		/// <param name="rec">The area of the page the tile covers</param>
+		/// <returns>The image, or nothing if not all four quadrants are there</returns>
+		std::optional<Image> build(const PDFTileCache::TileKey& key, const Geometry::Rectangle<float>& rec) {
+			auto it = tiles.find(key);
+			if (it == tiles.end()) {
+				return std::nullopt;
+			}
+
+			auto& tile = it->second;
+			if (std::any_of(tile.quadrants.begin(), tile.quadrants.end(), [](const Image& q) { return q.data == nullptr; })) {
+				return std::nullopt;
+			}
+			lru.splice(lru.begin(), lru, tile.lru);
+
+			// the quadrants overlap by the margin of the tiles, so they are placed by their position on the page
+			float scale = tile.dpi / MUPDF_DEFAULT_DPI;
+			std::array<Geometry::Point<size_t>, 4> offsets;
+			Geometry::Dimension<size_t> dims = { 0, 0 };
+			for (size_t i = 0; i < offsets.size(); i++) {
+				const auto& q = tile.quadrants.at(i);
+				offsets.at(i) = {
+					static_cast<size_t>(std::max(std::round((tile.recs.at(i).x - rec.x) * scale), 0.0f)),
+					static_cast<size_t>(std::max(std::round((tile.recs.at(i).y - rec.y) * scale), 0.0f))
+				};
+				dims.width = std::max(dims.width, offsets.at(i).x + q.dims.width);
+				dims.height = std::max(dims.height, offsets.at(i).y + q.dims.height);
+			}
+
+			Image img;
+			img.stride = BufferPool::get_aligned_stride(dims.width * 4);
+			img.size = img.stride * dims.height;
+			img.data = BufferPool::get_instance().acquire(std::max<size_t>(img.size, 1));
+			img.components = 4;
+			img.dims = dims;
+			img.dpi = static_cast<size_t>(tile.dpi);
+			std::memset(img.data.get(), 0, img.size);
+
+			for (size_t i = 0; i < offsets.size(); i++) {
+				copy_image(tile.quadrants.at(i), img, offsets.at(i).x, offsets.at(i).y);
+			}
+			return img;
+		}
+
+		void evict() {
+			while (bytes > budget and !lru.empty()) {
+				auto it = tiles.find(lru.back());
+				bytes -= it->second.bytes;
+				tiles.erase(it);
+				lru.pop_back();
+			}
+		}
+
+		void remove_if(const std::function<bool(const PDFTileCache::TileKey&)>& pred) {
+			for (auto it = tiles.begin(); it != tiles.end();) {
+				if (!pred(it->first)) {
+					++it;
+					continue;
+				}
+
+				bytes -= it->second.bytes;
+				lru.erase(it->second.lru);
+				it = tiles.erase(it);
+			}
+		}
+
+		void clear() {
+			tiles.clear();
+			lru.clear();
+			bytes = 0;
+		}
+	};
+
+	ThreadSafeWrapper<MipStore> m_mips;
+
+	// the generation of the viewport. It is increased whenever the viewport changes, which
+	// makes every job that was queued under an older generation stale
+	std::shared_ptr<std::atomic_size_t> m_generation = std::make_shared<std::atomic_size_t>(0);
+
+	Geometry::Rectangle<float> m_current_viewport;
+	float m_current_dpi = 92;
+	// the pages which intersected the viewport on the last request
+	std::vector<size_t> m_visible_pages;
+
+	// every bitmap that was handed to the processor. The ones that are drawn are pinned
+	PDFTileCache m_tile_cache;
+
+	PDFRenderStatistics m_stats;
+
+	// The render time per pixel which a single node of the display list adds to a page of one square unit. It is
+	// learned from every content tile and gives the cost of the regions which were never measured
+	float m_cost_per_node = 0;
+
+	// the previews are not part of the tile cache and have their own budget
+	size_t m_preview_budget = 64 * 1024 * 1024;
+	std::atomic_bool m_previews_dirty = true;
+
+	// how the viewport moved over the last requests
+	struct ViewportMotion {
+		Timer last_change;
+		// in document units per second
+		Geometry::Point<float> velocity = { 0, 0 };
+		// in doublings of the dpi per second
+		float zoom_velocity = 0;
+
+		// the direction and zoom trend the current prefetch jobs were queued for
+		Geometry::Point<float> prefetch_direction = { 0, 0 };
+		int prefetch_zoom = 0;
+	} m_motion;
+
+	// Prefetch jobs stay valid while the viewport keeps moving in the same direction. This
+	// generation is only increased when the direction changes
+	std::shared_ptr<std::atomic_size_t> m_prefetch_generation = std::make_shared<std::atomic_size_t>(0);
+	size_t m_prefetch_budget = 32 * 1024 * 1024;
+
+	// the tiles and display lists of documents that were opened before. Both are shared with the other renderers.
+	// They are only used once the content is hashed, until then the ones which were set are kept back
+	std::shared_ptr<PDFDiskTileCache> m_disk_cache;
+	std::shared_ptr<DiskStore> m_list_store;
+	std::shared_ptr<PDFDiskTileCache> m_pending_disk_cache;
+	std::shared_ptr<DiskStore> m_pending_list_store;
+	uint64_t m_content_hash = 0;
+	bool m_content_hashed = false;
+	std::once_flag m_content_hash_once;
+	std::future<void> m_content_hash_job;
+
+	impl() = default;
+	~impl() {
+		// the worker still uses the index
+		if (m_content_hash_job.valid()) {
+			m_content_hash_job.wait();
+		}
+	}
+
+	/// <summary>
+	/// Hashes the data of the file on a worker the first time one of the disk caches is set. The caches are enabled once it is done.
+	/// </summary>
+	void compute_content_hash(std::shared_ptr<PDF> pdf) {
+		std::call_once(m_content_hash_once, [&]() {
+			m_content_hash_job = std::async(std::launch::async, [this, pdf]() {
+				Timer time;
+				uint64_t hash = pdf->data == nullptr ? 0 : pdf->get_content_hash();
+				Logger::log("Hashed the document in ", time);
+
+				auto tiles = m_tiles.get();
+				m_content_hash = hash;
+				m_content_hashed = true;
+				enable_disk_caches();
+			});
+		});
+	}
+
+	/// <summary>
+	/// Uses the disk caches which were set, if the content is hashed already
+	/// </summary>
+	void enable_disk_caches() {
+		// the render threads read them while holding the index
+		auto tiles = m_tiles.get();
+		if (m_content_hashed) {
+			m_disk_cache = m_pending_disk_cache;
+			m_list_store = m_pending_list_store;
+		}
+	}
+
+	std::shared_ptr<DiskStore> get_list_store() {
+		auto tiles = m_tiles.get();
+		return m_list_store;
+	}
+
+	/// <summary>
+	/// Builds the display lists of the page. The content is loaded from the list store if it was stored
+	/// before, else it is interpreted and written to the store.
+	/// </summary>
+	/// <param name="store">The list store, may be nullptr</param>
+	std::optional<PageDisplayLists> build_lists(fz_context* ctx, PDF& pdf, size_t page, fz_cookie* cookie, const std::shared_ptr<DiskStore>& store) {
+		fz_display_list* cached = store == nullptr ? nullptr : DisplayListFormat::load(ctx, *store, m_content_hash, page);
+		if (store != nullptr) {
+			m_stats.add_list_store_lookup(cached != nullptr);
+		}
+
+		if (cached == nullptr) {
+			auto lists = build_page_lists(ctx, pdf, page, cookie);
+			if (store != nullptr and lists.has_value() and (cookie == nullptr or cookie->abort == 0)) {
+				DisplayListFormat::store(*store, lists->content->list, m_content_hash, page);
+			}
+			return lists;
+		}
+
+		// only the annotations and the widgets have to be interpreted
+		auto content = std::make_shared<DisplayListWrapper>(cached);
+		std::optional<PageDisplayLists> lists;
+		{
+			auto doc = pdf.get();
+			lists = record_page_lists(ctx, *doc, page, PAGE_LAYER_WIDGETS | PAGE_LAYER_ANNOTATIONS, cookie);
+		}
+
+		if (lists.has_value()) {
+			lists->content = content;
+		}
+		return lists;
+	}
+
+	static PDFRenderStatistics::JobKind get_job_kind(RenderThreadManager::JobType job, const PDFRenderInfo& info) {
+		if (job == RenderThreadManager::JobType::BUILD_DISPLAY_LIST) {
+			return PDFRenderStatistics::JobKind::DISPLAY_LIST;
+		}
+		// the layer of the tile is its content type, which has the same order as the job kinds
+		return static_cast<PDFRenderStatistics::JobKind>(info.key.layer);
+	}
+
+	/// <summary>
+	/// Hands the jobs to the render threads and counts them
+	/// </summary>
+	void queue_jobs(size_t renderer_id, std::vector<std::shared_ptr<RenderThreadManager::RenderJob>>& jobs) {
+		auto& trace = ChromeTrace::get_instance();
+		auto now = trace.is_enabled() ? trace.now_us() : -1;
+
+		for (const auto& job : jobs) {
+			m_stats.add_queued(get_job_kind(job->job, job->info));
+			job->queued_us = now;
+		}
+		thread_manager->add_jobs(renderer_id, jobs);
+	}
+
+	PDFDiskTileCache::TileKey get_disk_key(const PDFTileCache::TileKey& key) const {
+		return { m_content_hash, key.page, key.zoom, key.level, key.x, key.y };
+	}
+
+	/// <summary>
+	/// Decides how the cells of a block are rendered. A cell which would take too long is split until its tiles are
+	/// fast enough, four cells which together are cheap are merged into one tile.
+	/// </summary>
+	/// <param name="cost_ms">The estimated render time of every cell at the dpi of the grid</param>
+	/// <param name="can_merge">If the block has four cells and the merged tile is not too large</param>
+	static BlockLayout make_layout(const std::array<float, 4>& cost_ms, bool can_merge, float max_cost, float min_cost, size_t max_depth) {
+		BlockLayout layout;
+
+		float sum = cost_ms.at(0) + cost_ms.at(1) + cost_ms.at(2) + cost_ms.at(3);
+		if (can_merge and sum > 0 and sum < min_cost) {
+			layout.merged = true;
+			return layout;
+		}
+
+		for (size_t i = 0; i < cost_ms.size(); i++) {
+			float cost = cost_ms.at(i);
+			auto& depth = layout.depth.at(i);
+			while (cost > max_cost and depth < max_depth) {
+				cost /= 4;
+				depth++;
+			}
+		}
+		return layout;
+	}
+
+	bool is_on_disk(const PDFTileCache::TileKey& key) const {
+		return m_disk_cache != nullptr and
+			key.layer == static_cast<size_t>(RenderThreadManager::ContentType::CONTENT) and
+			m_disk_cache->contains(get_disk_key(key));
+	}
+
+	/// <summary>
+	/// Checks if the lists of every visible page are built and no tile of the viewport is waiting to be rendered.
+	/// Prefetched tiles and previews are not part of the viewport.
+	/// </summary>
+	bool is_view_complete(const TileIndex& tiles) const {
+		for (auto page : m_visible_pages) {
+			auto state = tiles.pages.at(page).list_state;
+			if (state == ListState::MISSING or state == ListState::QUEUED) {
+				return false;
+			}
+		}
+
+		return std::none_of(tiles.jobs.begin(), tiles.jobs.end(), [this](const auto& item) {
+			const auto& job = item.second;
+			return !job->prefetch and job->type != RenderThreadManager::ContentType::PREVIEW and
+				(job->info.recs + m_page_pos.at(job->info.page)).intersects(m_current_viewport);
+		});
+	}
+
+	/// <summary>
+	/// Creates the job which builds the display lists of the page. A queued prefetch build is replaced
+	/// if the lists are needed for the viewport, or if the direction of travel changed in the meantime.
+	/// </summary>
+	/// <param name="prefetch">If the job is part of the prefetch</param>
+	/// <returns>The job which has to be added to the render threads, or nullptr if nothing has to be done</returns>
+	std::shared_ptr<RenderThreadManager::RenderJob> queue_list_build(size_t page, float priority, bool prefetch) {
+		auto tiles = m_tiles.get();
+		auto& page_tiles = tiles->pages.at(page);
+
+		if (page_tiles.list_state == ListState::QUEUED) {
+			auto& queued = page_tiles.list_job;
+			bool replace = queued->prefetch and (!prefetch or queued->is_stale());
+			if (!replace or queued->status != RenderThreadManager::RenderStatus::WAITING) {
+				return nullptr;
+			}
+			queued->cookie.abort = 1;
+		}
+		else if (page_tiles.list_state != ListState::MISSING) {
+			return nullptr;
+		}
+
+		auto job = std::make_shared<RenderThreadManager::RenderJob>();
+		job->job = RenderThreadManager::JobType::BUILD_DISPLAY_LIST;
+		job->info.id = thread_manager->m_last_id.fetch_add(1);
+		job->info.page = page;
+		job->priority = priority;
+
+		if (prefetch) {
+			job->prefetch = true;
+			job->generation = m_prefetch_generation->load();
+			job->renderer_generation = m_prefetch_generation;
+		}
+
+		page_tiles.list_state = ListState::QUEUED;
+		page_tiles.list_job = job;
+		page_tiles.list_annot_revision = page_tiles.annot_revision;
+		return job;
+	}
+
+	/// <summary>
+	/// Makes the lists of the page available for rendering. The lists of a job are dropped if the job was
+	/// replaced in the meantime, and its annotation layer is dropped if a newer one was published while it ran.
+	/// </summary>
+	/// <param name="job_id">The id of the job which built the lists, or nullopt if they were built right away</param>
+	void store_display_lists(size_t page, std::optional<PageDisplayLists>&& lists, std::optional<size_t> job_id = std::nullopt) {
+		auto tiles = m_tiles.get();
+		auto& page_tiles = tiles->pages.at(page);
+
+		bool outdated_annotat = false;
+		if (job_id.has_value()) {
+			if (page_tiles.list_job == nullptr or page_tiles.list_job->info.id != *job_id) {
+				return;
+			}
+			outdated_annotat = page_tiles.list_annot_revision != page_tiles.annot_revision;
+		}
+		page_tiles.list_job = nullptr;
+
+		if (!lists.has_value()) {
+			page_tiles.list_state = ListState::FAILED;
+			return;
+		}
+
+		m_page_content.get_write()->at(page) = lists->content;
+		m_page_widgets.get_write()->at(page) = lists->widgets;
+		if (!outdated_annotat) {
+			m_page_annotat.get_write()->at(page) = lists->annotat;
+			page_tiles.annot_revision++;
+		}
+		page_tiles.list_state = ListState::READY;
+
+		// the page can get a preview now
+		m_previews_dirty = true;
+	}
+};
+
+
+
+std::unique_ptr<Docanto::PDFRenderer::RenderThreadManager> Docanto::PDFRenderer::thread_manager = nullptr;
+
+size_t Docanto::PDFRenderer::tread_manager_count = 0;
+size_t Docanto::PDFRenderer::render_thread_count = 0;
+std::atomic<float> Docanto::PDFRenderer::active_boost = 4.0f;
+size_t Docanto::PDFRenderer::last_id = 1;
+
+Docanto::PDFRenderer::PDFRenderer(std::shared_ptr<PDF> pdf_obj, std::shared_ptr<IPDFRenderImageProcessor> processor) : pimpl(std::make_unique<impl>()) {
+	if (thread_manager == nullptr) {
+		thread_manager = std::make_unique<RenderThreadManager>(render_thread_count);
+	}
+	tread_manager_count++;
+
+	id = last_id++;
+
+	this->pdf_obj = pdf_obj;
+	this->m_processor = processor;
+
+	position_pdfs();
+
+	// nothing is built yet, the display lists are created once the pages come close to the viewport
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	pimpl->m_tiles.get()->pages.resize(amount_of_pages);
+	pimpl->m_page_content.get_write()->resize(amount_of_pages);
+	pimpl->m_page_widgets.get_write()->resize(amount_of_pages);
+	pimpl->m_page_annotat.get_write()->resize(amount_of_pages);
+
+	thread_manager->set_callback(id, [&](PDFRenderInfo info, Image&& i, uint64_t cost_us) {receive_image(info, std::move(i), cost_us); }, [&](PDFRenderInfo info, RenderThreadManager::JobType type, uint64_t cost_us) {
+		// the job was dropped by the render thread so we can forget about it
+		pimpl->m_stats.add_cancelled(impl::get_job_kind(type, info));
+		if (type == RenderThreadManager::JobType::RENDER_BITMAP) {
+			auto dims = get_tile_dims(info.recs, info.dpi);
+			record_cost(info, cost_us, dims.width * dims.height);
+		}
+
+		auto tiles = pimpl->m_tiles.get();
+		tiles->remove_job(info.id);
+		if (tiles->targets.erase(info.id) != 0) {
+			m_processor->cancelImage(info.id);
+		}
+
+		auto& page_tiles = tiles->pages.at(info.page);
+		if (page_tiles.list_job != nullptr and page_tiles.list_job->info.id == info.id) {
+			page_tiles.list_job = nullptr;
+			page_tiles.list_state = impl::ListState::MISSING;
+		}
+	}, [&](PDFRenderInfo info, fz_context* ctx, fz_cookie* cookie) {
+		Timer time;
+		auto lists = pimpl->build_lists(ctx, *pdf_obj, info.page, cookie, pimpl->get_list_store());
+
+		// the lists were outdated before they were finished
+		if (cookie->abort) {
+			pimpl->m_stats.add_cancelled(PDFRenderStatistics::JobKind::DISPLAY_LIST);
+			return;
+		}
+
+		size_t bytes = 0;
+		if (lists.has_value()) {
+			for (const auto& list : { lists->content, lists->widgets, lists->annotat }) {
+				bytes += list == nullptr ? 0 : list->get_size();
+			}
+		}
+		pimpl->m_stats.add_completed(PDFRenderStatistics::JobKind::DISPLAY_LIST);
+		pimpl->m_stats.add_list_build(time.delta_us(), bytes);
+
+		pimpl->store_display_lists(info.page, std::move(lists), info.id);
+		Logger::log("Page ", info.page + 1, " Display lists built in ", time);
+
+		notify_completion();
+		notify_rendered(0, Geometry::Rectangle<float>(get_position(info.page), pdf_obj->get_page_dimension(info.page)));
+	}, [&](PDFRenderInfo info) {
+		load_from_disk(info);
+	}, [&](PDFRenderInfo info, const Geometry::Dimension<size_t>& dims) {
+		auto target = m_processor->acquireImage(info.id, dims, static_cast<size_t>(info.dpi));
+		if (!target.has_value()) {
+			return target;
+		}
+
+		if (target->data == nullptr or target->stride < dims.width * 4) {
+			Logger::error("The target for image ", info.id, " is too small");
+			m_processor->cancelImage(info.id);
+			return std::optional<ImageTarget>();
+		}
+
+		pimpl->m_tiles.get()->targets[info.id] = target->format;
+		return target;
+	});
+	//create_preview();
+
+}
+
+Docanto::PDFRenderer::~PDFRenderer() {
+	// any job of this renderer which is still queued will be dropped. The previews do not
+	// depend on the viewport so they have to be aborted on their own
+	{
+		auto tiles = pimpl->m_tiles.get();
+		for (auto& [_, job] : tiles->jobs) {
+			job->cookie.abort = 1;
+		}
+		for (auto& page_tiles : tiles->pages) {
+			if (page_tiles.list_job != nullptr) {
+				page_tiles.list_job->cookie.abort = 1;
+			}
+		}
+	}
+	abort_all_items();
+	thread_manager->remove_callback(id);
+	if (m_render_notifier != nullptr) {
+		m_render_notifier->remove_source(id);
+	}
+
+	tread_manager_count--;
+
+	if (tread_manager_count == 0) {
+		thread_manager.reset();
+	}
+}
+
+void Docanto::PDFRenderer::set_render_thread_count(size_t amount) {
+	render_thread_count = amount;
+
+	if (thread_manager != nullptr) {
+		Logger::warn("The amount of render threads will only change once all PDFRenderer are destroyed");
+	}
+}
+
+size_t Docanto::PDFRenderer::get_render_thread_count() {
+	if (thread_manager != nullptr) {
+		return thread_manager->get_amount_threads();
+	}
+
+	return render_thread_count == 0 ? std::max<size_t>(std::thread::hardware_concurrency(), 1) : render_thread_count;
+}
+
+void Docanto::PDFRenderer::set_active(bool active) {
+	if (active) {
+		thread_manager->set_active(id);
+	}
+	else {
+		thread_manager->clear_active(id);
+	}
+}
+
+bool Docanto::PDFRenderer::is_active() const {
+	return thread_manager->is_active(id);
+}
+
+void Docanto::PDFRenderer::set_active_boost(float boost) {
+	active_boost = boost;
+}
+
+// creates a pixmap which draws straight into a pooled buffer. The image owns the buffer, the pixmap only borrows it
+fz_pixmap* new_pooled_pixmap(fz_context* ctx, const fz_irect& bbox, Docanto::Image& obj) {
+	auto w = static_cast<size_t>(std::max(bbox.x1 - bbox.x0, 0));
+	auto h = static_cast<size_t>(std::max(bbox.y1 - bbox.y0, 0));
+	auto cs = fz_device_rgb(ctx);
+	// rgb and alpha
+	size_t components = static_cast<size_t>(fz_colorspace_n(ctx, cs)) + 1;
+	auto stride = Docanto::BufferPool::get_aligned_stride(w * components);
+
+	obj.data = Docanto::BufferPool::get_instance().acquire(stride * h);
+	obj.size = stride * h;
+	obj.stride = stride;
+	obj.components = components;
+	obj.dims = { w, h };
+
+	// fz_new_pixmap_with_bbox_and_data would pick the stride itself so the origin is set by hand
+	auto pixmap = fz_new_pixmap_with_data(ctx, cs, static_cast<int>(w), static_cast<int>(h), nullptr, 1, static_cast<int>(stride), obj.data.get());
+	pixmap->x = bbox.x0;
+	pixmap->y = bbox.y0;
+
+	return pixmap;
+}
+
+// creates a pixmap which draws into the buffer the processor handed out
+fz_pixmap* new_target_pixmap(fz_context* ctx, const fz_irect& bbox, const Docanto::ImageTarget& target, Docanto::Image& obj) {
+	auto w = static_cast<size_t>(std::max(bbox.x1 - bbox.x0, 0));
+	auto h = static_cast<size_t>(std::max(bbox.y1 - bbox.y0, 0));
+	auto cs = target.format == Docanto::ImageTarget::PixelFormat::BGRA ? fz_device_bgr(ctx) : fz_device_rgb(ctx);
+
+	obj.data = Docanto::borrow_buffer(target.data);
+	obj.size = target.stride * h;
+	obj.stride = target.stride;
+	obj.components = 4;
+	obj.dims = { w, h };
+
+	auto pixmap = fz_new_pixmap_with_data(ctx, cs, static_cast<int>(w), static_cast<int>(h), nullptr, 1, static_cast<int>(target.stride), target.data);
+	pixmap->x = bbox.x0;
+	pixmap->y = bbox.y0;
+
+	return pixmap;
+}
+
+// the size of the tile in pixels
+Docanto::Geometry::Dimension<size_t> get_tile_dims(const Docanto::Geometry::Rectangle<float>& scissor, const float dpi) {
+	auto fz_scissor = fz_make_rect(scissor.x, scissor.y, scissor.right(), scissor.bottom());
+	auto bbox = fz_round_rect(fz_transform_rect(fz_scissor, fz_transform_page(fz_scissor, dpi, 0)));
+
+	return { static_cast<size_t>(std::max(bbox.x1 - bbox.x0, 0)), static_cast<size_t>(std::max(bbox.y1 - bbox.y0, 0)) };
+}
+
+Docanto::Image get_image_from_list(fz_context* ctx, const DisplayListWrapper* wrap, const Docanto::Geometry::Rectangle<float>& scissor, const float dpi, fz_cookie* cookie, const Docanto::ImageTarget* target) {
+	// now we can render it
+	auto fz_scissor = fz_make_rect(scissor.x, scissor.y, scissor.right(), scissor.bottom());
+	auto ctm = fz_transform_page(fz_scissor, dpi, 0);
+
+	fz_pixmap* pixmap = nullptr;
+	fz_device* drawdevice = nullptr;
+	
+	auto bound = fz_transform_rect(fz_scissor, ctm);
+	auto bbox = fz_round_rect(bound);
+
+	Docanto::Image obj;
+	fz_try(ctx) {
+		// ___---___ Rendering part ___---___
+		// create new pixmap
+		if (target != nullptr) {
+			pixmap = new_target_pixmap(ctx, bbox, *target, obj);
+		}
+		else {
+			pixmap = new_pooled_pixmap(ctx, bbox, obj);
+		}
+		// create draw device
+		drawdevice = fz_new_draw_device(ctx, fz_identity, pixmap);
+		// render to draw device
+		fz_clear_pixmap(ctx, pixmap); // for transparent background
+		wrap->run(ctx, drawdevice, ctm, bound, cookie);
+
+		fz_close_device(ctx, drawdevice);
+		obj.dpi = dpi;
+	} fz_always(ctx) {
+		// drop all devices
+		fz_drop_device(ctx, drawdevice);
+		fz_drop_pixmap(ctx, pixmap);
+	} fz_catch(ctx) {
+		// a pooled buffer goes back to the pool
+		obj = Docanto::Image();
+		if (cookie->abort == 1) {
+			fz_ignore_error(ctx);
+		}
+		else {
+			Docanto::Logger::error("MUPdf Error: ", fz_convert_error(ctx, &((ctx)->error.errcode)));
+		}
+	}
+	return obj;
+}
+
+Docanto::Image get_image_from_list(DisplayListWrapper* wrap, Docanto::Geometry::Rectangle<float> scissor, float dpi) {
+	return get_image_from_list(*(Docanto::GlobalPDFContext::get_instance().get()), wrap, scissor, dpi);
+}
+
+float Docanto::PDFRenderer::get_chunk_scale(float dpi) const {
+	return std::floor(dpi / MUPDF_DEFAULT_DPI);
+}
+
+float Docanto::PDFRenderer::get_page_factor(size_t page) const {
+	const auto& dims = pimpl->m_page_dims.at(page);
+	return std::max(dims.width / 600.0, dims.height / 850.0);
+}
+
+float Docanto::PDFRenderer::get_level_dpi(size_t page, size_t level) const {
+	float bounds = std::floor(std::pow(2, static_cast<float>(level + 1)) / get_page_factor(page)) + 1;
+	return bounds * MUPDF_DEFAULT_DPI;
+}
+
+Docanto::PDFRenderer::TileGrid Docanto::PDFRenderer::get_tile_grid(size_t page, float dpi) const {
+	float scale = std::max(get_chunk_scale(dpi), 0.0001f) * get_page_factor(page); // to avoid negative values
+	//size_t amount_cells = std::max<size_t>(static_cast<size_t>(std::max<float>(std::log(scale) * 5, 1.0f)), 1);
+	size_t amount_cells = std::max<size_t>(static_cast<size_t>(std::pow(2, std::floor(std::log2(scale)))), 1);
+
+	return get_level_grid(page, static_cast<size_t>(std::log2(amount_cells)));
+}
+
+Docanto::PDFRenderer::TileGrid Docanto::PDFRenderer::get_level_grid(size_t page, size_t level) const {
+	auto dims = pdf_obj->get_page_dimension(page);
+
+	size_t amount_cells = size_t(1) << level;
+
+	TileGrid grid;
+	grid.amount_cells = amount_cells;
+	grid.cell = { dims.width / amount_cells, dims.height / amount_cells };
+	grid.dpi = get_level_dpi(page, level);
+
+	grid.key.document = id;
+	grid.key.page = page;
+	grid.key.zoom = static_cast<size_t>(grid.dpi);
+	grid.key.level = level;
+
+	return grid;
+}
+
+Docanto::PDFRenderer::TileGrid Docanto::PDFRenderer::get_target_grid(size_t page, float dpi) {
+	auto grid = get_tile_grid(page, dpi);
+
+	auto tiles = pimpl->m_tiles.get();
+	auto& level = tiles->pages.at(page).level;
+
+	// near the bounds of a level the zoom would switch between two levels on every small change. The
+	// previous level is kept until the zoom is clearly past its bounds
+	if (level.has_value() and level.value() != grid.key.level and
+		std::max(level.value(), grid.key.level) - std::min(level.value(), grid.key.level) == 1) {
+		float zoom = std::log2(std::max(dpi / MUPDF_DEFAULT_DPI, 0.0001f) * get_page_factor(page));
+		float previous = static_cast<float>(level.value());
+
+		if (zoom > previous - m_level_hysteresis and zoom < previous + 1 + m_level_hysteresis) {
+			grid = get_level_grid(page, level.value());
+		}
+	}
+
+	level = grid.key.level;
+	return grid;
+}
+
+Docanto::Geometry::Rectangle<float> Docanto::PDFRenderer::get_tile_rec(const PDFTileCache::TileKey& key, const Geometry::Dimension<float>& dims) const {
+	size_t amount_cells = size_t(1) << key.level;
+	Geometry::Dimension<float> cell_dim = { dims.width / amount_cells, dims.height / amount_cells };
+
+	return {
+		key.x * cell_dim.width - m_margin,
+		key.y * cell_dim.height - m_margin,
+		cell_dim.width + m_margin,
+		cell_dim.height + m_margin
+	};
+}
+
+void Docanto::PDFRenderer::record_cost(const PDFRenderInfo& info, uint64_t cost_us, size_t pixels) {
+	bool is_content = info.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::CONTENT);
+	bool is_annotation = info.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
+	if (cost_us == 0 or pixels == 0 or !(is_content or is_annotation)) {
+		return;
+	}
+
+	float us_per_pixel = static_cast<float>(cost_us) / pixels;
+	const auto& dims = pimpl->m_page_dims.at(info.page);
+
+	size_t nodes = 0;
+	if (is_content) {
+		auto list = pimpl->m_page_content.get_read()->at(info.page);
+		nodes = list == nullptr ? 0 : list->get_amount_nodes();
+	}
+
+	auto tiles = pimpl->m_tiles.get();
+	auto& page_tiles = tiles->pages.at(info.page);
+	page_tiles.costs.at(is_content ? 0 : 1).add(info.recs, dims, us_per_pixel);
+	page_tiles.cost_revision++;
+
+	if (nodes != 0) {
+		float sample = us_per_pixel * dims.width * dims.height / nodes;
+		auto& c = pimpl->m_cost_per_node;
+		c = c == 0 ? sample : c * 0.9f + sample * 0.1f;
+	}
+}
+
+float Docanto::PDFRenderer::estimate_cost(size_t page, const Geometry::Rectangle<float>& rec, float dpi) {
+	const auto& dims = pimpl->m_page_dims.at(page);
+	auto pixels = get_tile_dims(rec, dpi);
+
+	auto tiles = pimpl->m_tiles.get();
+	auto& costs = tiles->pages.at(page).costs;
+
+	// pages which were never measured are estimated by the amount of nodes in their lists
+	float content_prior = 0;
+	{
+		auto list = pimpl->m_page_content.get_read()->at(page);
+		if (list != nullptr and dims.width * dims.height > 0) {
+			content_prior = pimpl->m_cost_per_node * list->get_amount_nodes() / (dims.width * dims.height);
+		}
+	}
+
+	// both layers are rendered in their own jobs, the slower one decides
+	float us_per_pixel = std::max(costs.at(0).estimate(rec, dims, content_prior), costs.at(1).estimate(rec, dims, 0));
+	return us_per_pixel * pixels.width * pixels.height / 1000.0f;
+}
+
+void Docanto::PDFRenderer::update_layout(size_t page, const TileGrid& grid, size_t x, size_t y, bool change_existing) {
+	auto tiles = pimpl->m_tiles.get();
+	auto& page_tiles = tiles->pages.at(page);
+	auto& layouts = page_tiles.layouts[grid.key.zoom];
+
+	size_t amount_blocks = std::max<size_t>(grid.amount_cells / 2, 1);
+	size_t block = (y / 2) * amount_blocks + x / 2;
+	size_t amount_cells = std::min<size_t>(grid.amount_cells * grid.amount_cells, 4);
+
+	auto it = layouts.find(block);
+	if (it != layouts.end() and (!change_existing or it->second.revision == page_tiles.cost_revision)) {
+		return;
+	}
+
+	// the cost of every cell of the block at the dpi of the grid
+	const auto& dims = pimpl->m_page_dims.at(page);
+	std::array<float, 4> cost_ms = {};
+	for (size_t q = 0; q < amount_cells; q++) {
+		auto key = grid.key;
+		key.x = (x / 2) * 2 + q % 2;
+		key.y = (y / 2) * 2 + q / 2;
+		cost_ms.at(q) = estimate_cost(page, get_tile_rec(key, dims), grid.dpi);
+	}
+
+	// the merged tile has four times the pixels of a cell
+	auto cell_pixels = get_tile_dims(get_tile_rec(grid.key, dims), grid.dpi);
+	bool can_merge = amount_cells == 4 and cell_pixels.width * cell_pixels.height * 4 <= m_max_merged_pixels;
+
+	auto layout = impl::make_layout(cost_ms, can_merge, m_max_tile_cost, m_min_tile_cost, m_max_split_depth);
+	layout.revision = page_tiles.cost_revision;
+
+	if (it == layouts.end()) {
+		layouts[block] = layout;
+		return;
+	}
+
+	auto& current = it->second;
+	current.revision = layout.revision;
+	if (current.merged == layout.merged and current.depth == layout.depth) {
+		return;
+	}
+
+	// the layout is only changed while none of its tiles were rendered yet
+	std::vector<std::shared_ptr<RenderThreadManager::RenderJob>> waiting;
+	for (size_t q = 0; q < amount_cells; q++) {
+		for (auto key : get_layout_keys(page, grid, (x / 2) * 2 + q % 2, (y / 2) * 2 + q / 2)) {
+			for (auto layer : { RenderThreadManager::ContentType::CONTENT, RenderThreadManager::ContentType::ANNOTATION }) {
+				key.layer = static_cast<size_t>(layer);
+				if (page_tiles.bitmaps.contains(key) or pimpl->m_tile_cache.contains(key)) {
+					return;
+				}
+
+				auto job = page_tiles.jobs.find(key);
+				if (job == page_tiles.jobs.end()) {
+					continue;
+				}
+				if (job->second->status != RenderThreadManager::RenderStatus::WAITING) {
+					return;
+				}
+				waiting.push_back(job->second);
+			}
+		}
+	}
+
+	for (const auto& job : waiting) {
+		job->cookie.abort = 1;
+		tiles->remove_job(job->info.id);
+	}
+	current = layout;
+}
+
+std::vector<Docanto::PDFTileCache::TileKey> Docanto::PDFRenderer::get_layout_keys(size_t page, const TileGrid& grid, size_t x, size_t y) const {
+	auto key = grid.key;
+	key.x = x;
+	key.y = y;
+
+	auto tiles = pimpl->m_tiles.get();
+	const auto& layouts = tiles->pages.at(page).layouts;
+	auto grid_layouts = layouts.find(grid.key.zoom);
+	if (grid_layouts == layouts.end()) {
+		return { key };
+	}
+
+	size_t amount_blocks = std::max<size_t>(grid.amount_cells / 2, 1);
+	auto it = grid_layouts->second.find((y / 2) * amount_blocks + x / 2);
+	if (it == grid_layouts->second.end()) {
+		return { key };
+	}
+
+	const auto& layout = it->second;
+	if (layout.merged) {
+		key.level--;
+		key.x /= 2;
+		key.y /= 2;
+		return { key };
+	}
+
+	// the cell is split into smaller tiles which are rendered at the same dpi
+	size_t depth = layout.depth.at(x % 2 + (y % 2) * 2);
+	size_t amount = size_t(1) << depth;
+	std::vector<PDFTileCache::TileKey> keys;
+	keys.reserve(amount * amount);
+	for (size_t i = 0; i < amount * amount; i++) {
+		auto sub = key;
+		sub.level += depth;
+		sub.x = x * amount + i % amount;
+		sub.y = y * amount + i / amount;
+		keys.push_back(sub);
+	}
+	return keys;
+}
+
+bool Docanto::PDFRenderer::is_layout_key(size_t page, const TileGrid& grid, const PDFTileCache::TileKey& key) const {
+	if (key.zoom != grid.key.zoom) {
+		return false;
+	}
+
+	// the cell of the grid the tile belongs to
+	size_t x = key.x;
+	size_t y = key.y;
+	if (key.level >= grid.key.level) {
+		x >>= key.level - grid.key.level;
+		y >>= key.level - grid.key.level;
+	}
+	else if (key.level + 1 == grid.key.level) {
+		x *= 2;
+		y *= 2;
+	}
+	else {
+		return false;
+	}
+
+	auto keys = get_layout_keys(page, grid, x, y);
+	return std::any_of(keys.begin(), keys.end(), [&key](PDFTileCache::TileKey k) {
+		k.layer = key.layer;
+		return k == key;
+	});
+}
+
+std::vector<Docanto::PDFRenderer::PDFRenderInfo> Docanto::PDFRenderer::get_chunks(size_t page, const Geometry::Rectangle<float>& view, const TileGrid& grid, bool change_layouts) {
+	auto dims = pdf_obj->get_page_dimension(page);
+	auto  pos = pimpl->m_page_pos.at(page);
+	
+	auto amount_cells_w = grid.amount_cells; //std::max<size_t>(amount_cells * dims.width  / 600.0, 1);
+	auto amount_cells_h = grid.amount_cells; //std::max<size_t>(amount_cells * dims.height / 850.0, 1);
+	// transform the viewport to docspace
+	auto doc_space_screen = Docanto::Geometry::Rectangle<float>(view.upperleft() - pos, view.lowerright() - pos);
+
+	Geometry::Point<size_t> topleft = {
+		(size_t)std::clamp(std::floor(doc_space_screen.upperleft().x /  dims.width * amount_cells_w), 0.0f, (float)amount_cells_w),
+		(size_t)std::clamp(std::floor(doc_space_screen.upperleft().y / dims.height * amount_cells_h), 0.0f, (float)amount_cells_h),
+	};
+
+	Geometry::Point<size_t> bottomright = {
+		(size_t)std::clamp(std::ceil(doc_space_screen.lowerright().x / dims.width * amount_cells_w), 0.0f, (float)amount_cells_w),
+		(size_t)std::clamp(std::ceil(doc_space_screen.lowerright().y / dims.height * amount_cells_h), 0.0f, (float)amount_cells_h),
+	};
+
+	auto chunks = std::vector<PDFRenderInfo>();
+	auto dx = bottomright.x - topleft.x;
+	auto dy = bottomright.y - topleft.y;
+	chunks.reserve(dx * dy);
+
+	// a merged tile covers multiple cells but is only added once
+	std::unordered_set<PDFTileCache::TileKey, PDFTileCache::TileKeyHash> added;
+
+	for (size_t x = topleft.x; x < bottomright.x; ++x) {
+		for (size_t y = topleft.y; y < bottomright.y; ++y) {
+			update_layout(page, grid, x, y, change_layouts);
+
+			for (const auto& key : get_layout_keys(page, grid, x, y)) {
+				auto rec = get_tile_rec(key, dims);
+				// the tiles of a split cell which are not visible are left out
+				if (!rec.intersects(doc_space_screen) or !added.insert(key).second) {
+					continue;
+				}
+
+				PDFRenderInfo chunk;
+				chunk.recs = rec;
+				chunk.dpi = grid.dpi;
+				chunk.page = page;
+				chunk.key = key;
+
+				chunks.push_back(chunk);
+			}
+		}
 	}
+
+	return chunks;
 }
 
-Docanto::Image get_image_from_list(fz_context* ctx, fz_display_list* wrap, const Docanto::Geometry::Rectangle<float>& scissor, const float dpi, fz_cookie* cookie) {
-	// now we can render it
-	auto fz_scissor = fz_make_rect(scissor.x, scissor.y, scissor.right(), scissor.bottom());
-	auto ctm = fz_transform_page(fz_scissor, dpi, 0);
+Docanto::Image Docanto::PDFRenderer::get_image(size_t page, float dpi) {
+	float scale = dpi / MUPDF_DEFAULT_DPI;
+	fz_matrix ctm = fz_scale(scale, scale);
+
+	auto ctx = GlobalPDFContext::get_instance().get();
+	auto doc = pdf_obj->get();
+	auto pag = pdf_obj->get_page(page).get();
+
+	auto page_bounds = fz_bound_page(*ctx, *pag);
+
+	fz_rect transformed = fz_transform_rect(page_bounds, ctm);
+	fz_irect device_bbox = fz_round_rect(transformed);
 
 	fz_pixmap* pixmap = nullptr;
 	fz_device* drawdevice = nullptr;
-	
-	auto bound = fz_transform_rect(fz_scissor, ctm);
-	auto bbox = fz_round_rect(bound);
 
-	Docanto::Image obj;
-	fz_try(ctx) {
-		// ___---___ Rendering part ___---___
-		// create new pixmap
-		pixmap = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, nullptr, 1);
-		// create draw device
-		drawdevice = fz_new_draw_device(ctx, fz_identity, pixmap);
-		// render to draw device
-		fz_clear_pixmap(ctx, pixmap); // for transparent background
-		fz_run_display_list(ctx, wrap, drawdevice, ctm, bound, cookie);
+	Image obj;
+
+	fz_try(*ctx) {
+		pixmap = new_pooled_pixmap(*ctx, device_bbox, obj);
+		fz_clear_pixmap_with_value(*ctx, pixmap, 0xff); // for the white background
+
+		drawdevice = fz_new_draw_device(*ctx, fz_identity, pixmap);
+		fz_run_page(*ctx, *pag, drawdevice, ctm, nullptr);
+		fz_close_device(*ctx, drawdevice);
+
+		obj.dpi = dpi;
+	} fz_always(*ctx) {
+		fz_drop_device(*ctx, drawdevice);
+		fz_drop_pixmap(*ctx, pixmap);
+	} fz_catch(*ctx) {
+		return Docanto::Image();
+	}
+
+	return obj;
+}
+
+
+void Docanto::PDFRenderer::position_pdfs() {
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto& positions = pimpl->m_page_pos;
+
+	float y = 0;
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		auto dims = pdf_obj->get_page_dimension(i);
+		positions.push_back({0, y});
+		pimpl->m_page_dims.push_back(dims);
+		y += dims.height + 10;
+	}
+}
+
+
+Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> Docanto::PDFRenderer::get_preview() {
+	return pimpl->m_previewbitmaps.get_read();
+}
+
+std::vector<Docanto::Geometry::Rectangle<double>> Docanto::PDFRenderer::get_clipped_page_recs() {
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto& positions = pimpl->m_page_pos;
+	std::vector<Docanto::Geometry::Rectangle<double>> recs;
+
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		auto dims = pdf_obj->get_page_dimension(i);
+		Docanto::Geometry::Rectangle<double> rec = { positions[i], dims };
+		if (rec.intersects(pimpl->m_current_viewport)) {
+			recs.push_back(rec);
+		}
+	}
+
+	return recs;
+}
+
+float Docanto::PDFRenderer::get_visible_area(const Geometry::Rectangle<float>& view) const {
+	float area = 0;
+	for (size_t i = 0; i < pimpl->m_page_pos.size(); i++) {
+		auto visible = Geometry::Rectangle<float>(pimpl->m_page_pos.at(i), pimpl->m_page_dims.at(i)).intersection(view);
+		if (visible.width > 0 and visible.height > 0) {
+			area += visible.width * visible.height;
+		}
+	}
+	return area;
+}
+
+std::vector<Docanto::Geometry::Rectangle<double>> Docanto::PDFRenderer::get_page_recs() {
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto& positions = pimpl->m_page_pos;
+	std::vector<Docanto::Geometry::Rectangle<double>> recs;
+
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		auto dims = pdf_obj->get_page_dimension(i);
+		Docanto::Geometry::Rectangle<double> rec = { positions[i], dims };
+		recs.push_back(rec);
+	}
+
+	return recs;
+}
+
+Docanto::Geometry::Point<float> Docanto::PDFRenderer::get_position(size_t page) {
+	return pimpl->m_page_pos.at(page);
+}
+
+void Docanto::PDFRenderer::set_position(size_t page, Geometry::Point<float> pos) {
+	pimpl->m_page_pos.at(page) = pos;
+
+	if (m_viewport_trace != nullptr) {
+		m_viewport_trace->record_position(id, page, pos);
+	}
+}
+
+Docanto::Geometry::Dimension<float> Docanto::PDFRenderer::get_max_dimension() {
+	Docanto::Geometry::Dimension<float> dim = { 0, 0 };
+	for (size_t i = 0; i < pdf_obj->get_page_count(); i++) {
+		auto d = pdf_obj->get_page_dimension(i);
+		dim.width = std::max(dim.width, d.width);
+		dim.height = std::max(dim.height, d.height);
+	}
+	return dim;
+}
+
+
+Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> Docanto::PDFRenderer::draw() {
+	return pimpl->m_highDefBitmaps.get_read();
+}
+
+Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> Docanto::PDFRenderer::annot() {
+	return pimpl->m_annotationBitmaps.get_read();
+}
+
+
+void Docanto::PDFRenderer::remove_from_processor(size_t image_id) {
+	auto tiles = pimpl->m_tiles.get();
+	auto remove = [&tiles, image_id](const PDFRenderInfo& obj) {
+		if (obj.id != image_id) {
+			return false;
+		}
+		tiles->remove_bitmap(obj);
+		return true;
+	};
+
+	std::erase_if(*pimpl->m_highDefBitmaps.get_write(), remove);
+	std::erase_if(*pimpl->m_annotationBitmaps.get_write(), remove);
+
+	m_processor->deleteImage(image_id);
+}
+
+void Docanto::PDFRenderer::add_to_processor() {
+	// TODO
+}
+
+void Docanto::PDFRenderer::release_bitmaps(const std::vector<PDFRenderInfo>& infos) {
+	if (infos.empty()) {
+		return;
+	}
+
+	std::unordered_set<size_t> ids;
+	{
+		auto tiles = pimpl->m_tiles.get();
+		for (const auto& info : infos) {
+			ids.insert(info.id);
+			tiles->remove_bitmap(info);
+		}
+
+		// only one pass over the lists, no matter how many bitmaps are released
+		auto released = [&ids](const PDFRenderInfo& obj) {
+			return ids.contains(obj.id);
+		};
+		std::erase_if(*pimpl->m_highDefBitmaps.get_write(), released);
+		std::erase_if(*pimpl->m_annotationBitmaps.get_write(), released);
+	}
+
+	// the cache keeps the bitmap around until it needs the memory
+	for (const auto& info : infos) {
+		if (!pimpl->m_tile_cache.unpin(info.key, info.id)) {
+			m_processor->deleteImage(info.id);
+		}
+	}
+}
+
+void Docanto::PDFRenderer::evict_tiles() {
+	for (auto image_id : pimpl->m_tile_cache.evict()) {
+		m_processor->deleteImage(image_id);
+	}
+}
+
+size_t Docanto::PDFRenderer::take_from_cache(std::vector<PDFRenderInfo>& chunks, ThreadSafeVector<PDFRenderInfo>& info) {
+	auto tiles = pimpl->m_tiles.get();
+	auto bitmaps = info.get_write();
+	std::vector<PDFRenderInfo> replaced;
+
+	auto amount = std::erase_if(chunks, [&](const PDFRenderInfo& chunk) {
+		auto image_id = pimpl->m_tile_cache.lookup(chunk.key);
+		if (!image_id.has_value()) {
+			return false;
+		}
+
+		// the tile may have been built from the finer level in the meantime
+		auto& page_bitmaps = tiles->pages.at(chunk.page).bitmaps;
+		auto drawn = page_bitmaps.find(chunk.key);
+		if (drawn != page_bitmaps.end() and drawn->second.id != image_id.value()) {
+			replaced.push_back(drawn->second);
+		}
+
+		auto cached = chunk;
+		cached.id = image_id.value();
+		bitmaps->push_back(cached);
+		tiles->add_bitmap(cached);
+		return true;
+	});
+
+	std::erase_if(*bitmaps, [&replaced](const PDFRenderInfo& obj) {
+		return std::any_of(replaced.begin(), replaced.end(), [&obj](const PDFRenderInfo& r) { return r.id == obj.id; });
+	});
+	for (const auto& r : replaced) {
+		if (!pimpl->m_tile_cache.unpin(r.key, r.id)) {
+			m_processor->deleteImage(r.id);
+		}
+	}
+
+	return amount;
+}
+
+size_t Docanto::PDFRenderer::take_from_disk(std::vector<PDFRenderInfo>& chunks) {
+	auto tiles = pimpl->m_tiles.get();
+	if (pimpl->m_disk_cache == nullptr) {
+		return 0;
+	}
+
+	auto page_rec = [this](size_t page) {
+		return Geometry::Rectangle<float>(pimpl->m_page_pos.at(page), pimpl->m_page_dims.at(page));
+	};
+
+	std::vector<std::shared_ptr<RenderThreadManager::RenderJob>> new_jobs;
+	std::erase_if(chunks, [&](const PDFRenderInfo& chunk) {
+		if (!pimpl->is_on_disk(chunk.key)) {
+			pimpl->m_stats.add_disk_lookup(false);
+			return false;
+		}
+
+		// the file is read by the render threads. Like a rendered tile the job becomes stale with the viewport
+		auto job = std::make_shared<RenderThreadManager::RenderJob>();
+		job->chunk_rec = chunk.recs;
+		job->info = chunk;
+		job->info.id = thread_manager->m_last_id.fetch_add(1);
+		job->status = RenderThreadManager::RenderStatus::WAITING;
+		job->type = RenderThreadManager::ContentType::CONTENT;
+		job->job = RenderThreadManager::JobType::LOAD_FROM_DISK;
+
+		// reading a tile is much cheaper than rendering it, so it goes ahead of the tiles of the viewport
+		job->priority = get_tile_priority(pimpl->m_current_viewport, page_rec(chunk.page), chunk.recs + get_position(chunk.page), false) - 1.0f;
+		job->generation = pimpl->m_generation->load();
+		job->renderer_generation = pimpl->m_generation;
+
+		tiles->add_job(job);
+		new_jobs.push_back(job);
+		return true;
+	});
+
+	pimpl->queue_jobs(id, new_jobs);
+	return new_jobs.size();
+}
+
+void Docanto::PDFRenderer::load_from_disk(PDFRenderInfo info) {
+	auto kind = impl::get_job_kind(RenderThreadManager::JobType::LOAD_FROM_DISK, info);
+
+	std::shared_ptr<PDFDiskTileCache> disk_cache;
+	{
+		auto tiles = pimpl->m_tiles.get();
+		// the job was dropped while it was waiting
+		if (!tiles->jobs.contains(info.id)) {
+			pimpl->m_stats.add_wasted(kind);
+			return;
+		}
+		disk_cache = pimpl->m_disk_cache;
+	}
+
+	// the file is read and downsampled without holding the index
+	std::optional<Image> img;
+	if (disk_cache != nullptr) {
+		img = disk_cache->load(pimpl->get_disk_key(info.key));
+	}
+	pimpl->m_stats.add_disk_lookup(img.has_value());
+
+	std::optional<Image> mip;
+	if (img.has_value() and info.key.level > 0 and pimpl->m_mips.get()->budget != 0) {
+		mip = downsample_image(img.value());
+	}
+
+	auto tiles = pimpl->m_tiles.get();
+	if (!tiles->jobs.contains(info.id)) {
+		pimpl->m_stats.add_wasted(kind);
+		return;
+	}
+	tiles->remove_job(info.id);
+
+	// the file was broken and is deleted, the tile is rendered with the next request
+	if (!img.has_value()) {
+		pimpl->m_stats.add_wasted(kind);
+		notify_completion();
+		notify_rendered(0, info.recs + get_position(info.page));
+		return;
+	}
+
+	m_processor->processImage(info.id, img.value());
+	if (mip.has_value()) {
+		store_mip(info, std::move(mip.value()));
+	}
+	pimpl->m_stats.add_completed(kind);
+
+	// an outdated bitmap of the same tile is replaced by the new one
+	std::vector<PDFRenderInfo> outdated;
+	auto& page_bitmaps = tiles->pages.at(info.page).bitmaps;
+	auto drawn = page_bitmaps.find(info.key);
+	if (drawn != page_bitmaps.end() and drawn->second.id != info.id) {
+		outdated.push_back(drawn->second);
+	}
+
+	auto replaced = pimpl->m_tile_cache.insert(info.key, info.id, img->size);
+	if (replaced.has_value() and (outdated.empty() or outdated.front().id != replaced.value())) {
+		m_processor->deleteImage(replaced.value());
+	}
+
+	pimpl->m_highDefBitmaps.get_write()->push_back(info);
+	tiles->add_bitmap(info);
+	release_bitmaps(outdated);
+	evict_tiles();
+
+	notify_completion();
+	notify_rendered(info.id, info.recs + get_position(info.page));
+}
+
+size_t Docanto::PDFRenderer::take_from_mips(std::vector<PDFRenderInfo>& chunks, ThreadSafeVector<PDFRenderInfo>& info) {
+	if (chunks.empty()) {
+		return 0;
+	}
+
+	auto tiles = pimpl->m_tiles.get();
+	auto mips = pimpl->m_mips.get();
+	auto bitmaps = info.get_write();
+	size_t amount_built = 0;
+
+	std::erase_if(chunks, [&](const PDFRenderInfo& chunk) {
+		// a tile which was built before is still drawn until the rendered one arrives
+		if (tiles->pages.at(chunk.page).bitmaps.contains(chunk.key)) {
+			return false;
+		}
+
+		auto img = mips->build(chunk.key, chunk.recs);
+		if (!img.has_value()) {
+			return false;
+		}
+
+		// the built tiles are not part of the tile cache, they are deleted once they are released
+		auto built = chunk;
+		built.id = thread_manager->m_last_id.fetch_add(1);
+		built.dpi = static_cast<float>(img->dpi);
+		m_processor->processImage(built.id, img.value());
+
+		bitmaps->push_back(built);
+		tiles->add_bitmap(built);
+		pimpl->m_stats.add_mip_build();
+		amount_built++;
+
+		// the finer level has a bit less than twice the dpi, it is only rendered if that is not enough for the screen
+		return built.dpi >= pimpl->m_current_dpi;
+	});
+
+	return amount_built;
+}
+
+void Docanto::PDFRenderer::store_mip(const PDFRenderInfo& info, Image&& mip) {
+	// the split and merged tiles are not at the dpi of their level
+	if (info.key.level == 0 or mip.data == nullptr or !FLOAT_EQUAL(info.dpi, get_level_dpi(info.page, info.key.level))) {
+		return;
+	}
+
+	// the tile is one quadrant of the tile of the coarser level
+	auto parent = info.key;
+	parent.level--;
+	parent.x /= 2;
+	parent.y /= 2;
+	parent.zoom = static_cast<size_t>(get_level_dpi(info.page, parent.level));
+	size_t quadrant = (info.key.x % 2) + (info.key.y % 2) * 2;
+
+	pimpl->m_mips.get()->insert(parent, quadrant, info.recs, info.dpi / 2, std::move(mip));
+}
+
+void Docanto::PDFRenderer::set_disk_cache(std::shared_ptr<PDFDiskTileCache> cache) {
+	{
+		auto tiles = pimpl->m_tiles.get();
+		pimpl->m_pending_disk_cache = cache;
+		pimpl->enable_disk_caches();
+	}
+
+	if (cache != nullptr) {
+		pimpl->compute_content_hash(pdf_obj);
+	}
+}
+
+void Docanto::PDFRenderer::set_display_list_store(std::shared_ptr<DiskStore> store) {
+	{
+		auto tiles = pimpl->m_tiles.get();
+		pimpl->m_pending_list_store = store;
+		pimpl->enable_disk_caches();
+	}
+
+	if (store != nullptr) {
+		pimpl->compute_content_hash(pdf_obj);
+	}
+}
 
-		fz_close_device(ctx, drawdevice);
-		// ___---___ Bitmap creatin and display part ___---___
-		// create the bitmap
-		obj.data = std::unique_ptr<byte>(pixmap->samples); // , size, (unsigned int)pixmap->stride, 96); // default dpi of the pixmap
-		obj.dims = { (size_t)(bbox.x1 - bbox.x0), (size_t)(bbox.y1 - bbox.y0) };
-		obj.size = pixmap->h * pixmap->stride;
-		obj.stride = pixmap->stride;
-		obj.components = pixmap->n;
-		obj.dpi = dpi;
+void Docanto::PDFRenderer::set_cache_budget(size_t bytes) {
+	pimpl->m_tile_cache.set_budget(bytes);
+	evict_tiles();
+}
 
-		pixmap->samples = nullptr;
-	} fz_always(ctx) {
-		// drop all devices
-		fz_drop_device(ctx, drawdevice);
-		fz_drop_pixmap(ctx, pixmap);
-	} fz_catch(ctx) {
-		if (cookie->abort == 1) {
-			fz_ignore_error(ctx);
+Docanto::PDFRenderStatistics::Snapshot Docanto::PDFRenderer::stats() const {
+	auto snapshot = pimpl->m_stats.snapshot();
+	auto count = [&snapshot](const RenderThreadManager::RenderJob& job) {
+		auto& counters = snapshot.jobs.at(static_cast<size_t>(impl::get_job_kind(job.job, job.info)));
+		auto status = job.status.load();
+		if (status == RenderThreadManager::RenderStatus::WAITING) {
+			counters.queue_depth++;
 		}
-		else {
-			Docanto::Logger::error("MUPdf Error: ", fz_convert_error(ctx, &((ctx)->error.errcode)));
+		else if (status == RenderThreadManager::RenderStatus::PROCESSING) {
+			counters.running++;
+		}
+	};
+
+	{
+		auto tiles = pimpl->m_tiles.get();
+		for (const auto& [_, job] : tiles->jobs) {
+			count(*job);
+		}
+		for (const auto& page_tiles : tiles->pages) {
+			if (page_tiles.list_job != nullptr) {
+				count(*page_tiles.list_job);
+			}
+			snapshot.preview_bytes += page_tiles.preview_bytes;
 		}
 	}
-	return obj;
+
+	snapshot.tile_cache = pimpl->m_tile_cache.get_statistics();
+	snapshot.tile_bytes = snapshot.tile_cache.bytes;
+	thread_manager->get_statistics(id, snapshot);
+	return snapshot;
 }
 
-Docanto::Image get_image_from_list(DisplayListWrapper* wrap, Docanto::Geometry::Rectangle<float> scissor, float dpi) {
-	return get_image_from_list(*(Docanto::GlobalPDFContext::get_instance().get()), *(wrap->get().get()), scissor, dpi);
+Docanto::PDFTileCache::Statistics Docanto::PDFRenderer::get_cache_statistics() const {
+	return pimpl->m_tile_cache.get_statistics();
 }
 
-float Docanto::PDFRenderer::get_chunk_scale() const {
-	return std::floor(pimpl->m_current_dpi / MUPDF_DEFAULT_DPI);
+void Docanto::PDFRenderer::set_preview_budget(size_t bytes) {
+	pimpl->m_preview_budget = bytes;
+	pimpl->m_previews_dirty = true;
 }
 
-std::pair<std::vector<Docanto::Geometry::Rectangle<float>>, float> Docanto::PDFRenderer::get_chunks(size_t page) {
-	auto dims = pdf_obj->get_page_dimension(page);
-	auto  pos = pimpl->m_page_pos.at(page);
+void Docanto::PDFRenderer::set_mip_budget(size_t bytes) {
+	auto mips = pimpl->m_mips.get();
+	mips->budget = bytes;
+	mips->evict();
+}
 
-	float a = std::max(dims.width / 600.0, dims.height / 850.0);
-	float scale = std::max(get_chunk_scale(), 0.0001f) * a; // to avoid negative values
-	//size_t amount_cells = std::max<size_t>(static_cast<size_t>(std::max<float>(std::log(scale) * 5, 1.0f)), 1);
-	size_t amount_cells = std::max<size_t>(static_cast<size_t>(std::pow(2, std::floor(std::log2(scale)))), 1);
-	float layer = std::floor(std::log2(amount_cells)) + 1;
-	float bounds = std::floor(std::pow(2, layer) / a) + 1;
-	float max_dpi = bounds * MUPDF_DEFAULT_DPI;
-	
-	auto amount_cells_w = amount_cells; //std::max<size_t>(amount_cells * dims.width  / 600.0, 1);
-	auto amount_cells_h = amount_cells; //std::max<size_t>(amount_cells * dims.height / 850.0, 1);
-	Geometry::Dimension<float> cell_dim = { dims.width / amount_cells_w, dims.height / amount_cells_h };
-	// transform the viewport to docspace
-	auto doc_space_screen = Docanto::Geometry::Rectangle<float>(pimpl->m_current_viewport.upperleft() - pos, pimpl->m_current_viewport.lowerright() - pos);
+void Docanto::PDFRenderer::set_prefetch_budget(size_t bytes) {
+	pimpl->m_prefetch_budget = bytes;
+}
 
-	Geometry::Point<size_t> topleft = {
-		(size_t)std::clamp(std::floor(doc_space_screen.upperleft().x /  dims.width * amount_cells_w), 0.0f, (float)amount_cells_w),
-		(size_t)std::clamp(std::floor(doc_space_screen.upperleft().y / dims.height * amount_cells_h), 0.0f, (float)amount_cells_h),
-	};
+void Docanto::PDFRenderer::set_prefetch_lookahead(float seconds) {
+	m_prefetch_lookahead = seconds;
+}
 
-	Geometry::Point<size_t> bottomright = {
-		(size_t)std::clamp(std::ceil(doc_space_screen.lowerright().x / dims.width * amount_cells_w), 0.0f, (float)amount_cells_w),
-		(size_t)std::clamp(std::ceil(doc_space_screen.lowerright().y / dims.height * amount_cells_h), 0.0f, (float)amount_cells_h),
-	};
+void Docanto::PDFRenderer::request_previews() {
+	auto tiles = pimpl->m_tiles.get();
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto& positions = pimpl->m_page_pos;
+	auto center = pimpl->m_current_viewport.center();
 
-	auto chunks = std::vector<Docanto::Geometry::Rectangle<float>>();
-	auto dx = bottomright.x - topleft.x;
-	auto dy = bottomright.y - topleft.y;
-	chunks.reserve(dx * dy);
+	// the pages closest to the viewport get their preview first
+	std::vector<std::pair<float, size_t>> order;
+	order.reserve(amount_of_pages);
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		auto pdf_rec = Geometry::Rectangle<float>(positions.at(i), pdf_obj->get_page_dimension(i));
+		float distance = pdf_rec.intersects(pimpl->m_current_viewport) ? 0.0f : (pdf_rec.center() - center).distance();
+		order.push_back({ distance, i });
+	}
+	std::sort(order.begin(), order.end());
+
+	float scale = m_preview_dpi / MUPDF_DEFAULT_DPI;
+	size_t planned_bytes = 0;
+	std::vector<PDFRenderInfo> to_delete;
+	std::vector<size_t> to_abort;
+	std::vector<std::shared_ptr<RenderThreadManager::RenderJob>> new_jobs;
+	auto content = pimpl->m_page_content.get_read();
+
+	for (size_t rank = 0; rank < order.size(); rank++) {
+		auto page = order.at(rank).second;
+		auto dims = pdf_obj->get_page_dimension(page);
+		auto& page_tiles = tiles->pages.at(page);
+
+		// pages without display lists will get their preview once the lists are built
+		if (content->at(page) == nullptr and !page_tiles.preview.has_value()) {
+			continue;
+		}
 
-	for (size_t x = topleft.x; x < bottomright.x; ++x) {
-		for (size_t y = topleft.y; y < bottomright.y; ++y) {
-			chunks.push_back({
-				x * cell_dim.width - m_margin,
-				y * cell_dim.height - m_margin,
-				cell_dim.width + m_margin,
-				cell_dim.height + m_margin
-				});
+		PDFTileCache::TileKey key;
+		key.document = id;
+		key.page = page;
+		key.zoom = static_cast<size_t>(m_preview_dpi);
+		key.layer = static_cast<size_t>(RenderThreadManager::ContentType::PREVIEW);
+
+		// before the preview is rendered we can only estimate its size, 4 bytes per pixel
+		planned_bytes += page_tiles.preview.has_value() ? page_tiles.preview_bytes :
+			static_cast<size_t>(std::ceil(dims.width * scale) * std::ceil(dims.height * scale) * 4);
+
+		auto queued = page_tiles.jobs.find(key);
+
+		// the pages which are too far away make room for the closer ones
+		if (planned_bytes > pimpl->m_preview_budget) {
+			if (page_tiles.preview.has_value()) {
+				to_delete.push_back(page_tiles.preview.value());
+				page_tiles.preview.reset();
+				page_tiles.preview_bytes = 0;
+			}
+			if (queued != page_tiles.jobs.end()) {
+				queued->second->cookie.abort = 1;
+				to_abort.push_back(queued->second->info.id);
+			}
+			continue;
+		}
+
+		if (page_tiles.preview.has_value() or queued != page_tiles.jobs.end()) {
+			continue;
+		}
+
+		auto job = std::make_shared<RenderThreadManager::RenderJob>();
+		job->info.id = thread_manager->m_last_id.fetch_add(1);
+		job->info.page = page;
+		job->info.dpi = m_preview_dpi;
+		job->info.recs = { 0, 0, dims.width, dims.height };
+		job->info.key = key;
+		job->chunk_rec = job->info.recs;
+		job->status = RenderThreadManager::RenderStatus::WAITING;
+		job->type = RenderThreadManager::ContentType::PREVIEW;
+
+		// the previews are rendered after all the tiles
+		job->priority = 10.0f + rank;
+
+		// previews are needed no matter where the viewport is, so they are never stale
+		job->job = RenderThreadManager::JobType::RENDER_BITMAP;
+		job->list = content->at(page);
+		tiles->add_job(job);
+		new_jobs.push_back(job);
+	}
+
+	for (auto job_id : to_abort) {
+		tiles->remove_job(job_id);
+	}
+
+	if (!to_delete.empty()) {
+		auto previews = pimpl->m_previewbitmaps.get_write();
+		for (const auto& info : to_delete) {
+			std::erase_if(*previews, [&info](const PDFRenderInfo& obj) {
+				return obj.id == info.id;
+			});
+			m_processor->deleteImage(info.id);
 		}
 	}
 
-	return { chunks, max_dpi };
+	pimpl->queue_jobs(id, new_jobs);
 }
 
-Docanto::Image Docanto::PDFRenderer::get_image(size_t page, float dpi) {
-	float scale = dpi / MUPDF_DEFAULT_DPI;
-	fz_matrix ctm = fz_scale(scale, scale);
+size_t Docanto::PDFRenderer::cull_bitmaps(ThreadSafeVector<PDFRenderInfo>& info, size_t page, const TileGrid& grid) {
+	ChromeTrace::Span span("cull bitmaps", "cull");
+	span.arg("page", static_cast<double>(page));
+
+	auto layer = static_cast<size_t>(&info == &pimpl->m_annotationBitmaps ? RenderThreadManager::ContentType::ANNOTATION : RenderThreadManager::ContentType::CONTENT);
+	auto position = get_position(page);
+	std::vector<PDFRenderInfo> to_release;
+
+	{
+		auto tiles = pimpl->m_tiles.get();
+		const auto& page_bitmaps = tiles->pages.at(page).bitmaps;
+		auto view = Geometry::Rectangle<float>(pimpl->m_current_viewport.upperleft() - position, pimpl->m_current_viewport.lowerright() - position);
+
+		// the grids of the other levels are only calculated once per call
+		std::map<size_t, TileGrid> grids = { { grid.key.level, grid } };
+		auto get_grid = [&](size_t level) -> const TileGrid& {
+			auto it = grids.find(level);
+			if (it == grids.end()) {
+				it = grids.emplace(level, get_level_grid(page, level)).first;
+			}
+			return it->second;
+		};
 
-	auto ctx = GlobalPDFContext::get_instance().get();
-	auto doc = pdf_obj->get();
-	auto pag = pdf_obj->get_page(page).get();
+		// looks up if every tile of the level below the rectangle is drawn. The cells of the target level may be
+		// split or merged, so their tiles are taken from the layout
+		const auto& dims = pimpl->m_page_dims.at(page);
+		auto covered_by_level = [&](const Geometry::Rectangle<float>& rec, size_t level) {
+			const auto& level_grid = get_grid(level);
+			auto to_cell = [](float v, float cell, size_t amount) {
+				return static_cast<size_t>(std::clamp(v / cell, 0.0f, static_cast<float>(amount)));
+			};
 
-	auto page_bounds = fz_bound_page(*ctx, *pag);
+			size_t x0 = to_cell(rec.x, level_grid.cell.width, level_grid.amount_cells);
+			size_t y0 = to_cell(rec.y, level_grid.cell.height, level_grid.amount_cells);
+			size_t x1 = to_cell(std::ceil(rec.right() / level_grid.cell.width) * level_grid.cell.width, level_grid.cell.width, level_grid.amount_cells);
+			size_t y1 = to_cell(std::ceil(rec.bottom() / level_grid.cell.height) * level_grid.cell.height, level_grid.cell.height, level_grid.amount_cells);
+			if (x0 >= x1 or y0 >= y1) {
+				return false;
+			}
 
-	fz_rect transformed = fz_transform_rect(page_bounds, ctm);
-	fz_irect device_bbox = fz_round_rect(transformed);
-	int w = device_bbox.x1 - device_bbox.x0;
-	int h = device_bbox.y1 - device_bbox.y0;
+			auto key = level_grid.key;
+			key.layer = layer;
+			for (key.x = x0; key.x < x1; key.x++) {
+				for (key.y = y0; key.y < y1; key.y++) {
+					if (level != grid.key.level) {
+						if (!page_bitmaps.contains(key)) {
+							return false;
+						}
+						continue;
+					}
 
-	fz_pixmap* pixmap = nullptr;
-	fz_device* drawdevice = nullptr;
+					for (auto tile : get_layout_keys(page, grid, key.x, key.y)) {
+						tile.layer = layer;
+						if (get_tile_rec(tile, dims).intersects(rec) and !page_bitmaps.contains(tile)) {
+							return false;
+						}
+					}
+				}
+			}
+			return true;
+		};
 
-	Image obj;
+		for (const auto& [key, item] : page_bitmaps) {
+			if (key.layer != layer) {
+				continue;
+			}
 
-	fz_try(*ctx) {
-		pixmap = fz_new_pixmap_with_bbox(*ctx, fz_device_rgb(*ctx), device_bbox, nullptr, 1);
-		fz_clear_pixmap_with_value(*ctx, pixmap, 0xff); // for the white background
+			// the tiles which are not visible are not drawn anymore
+			if (!(item.recs + position).intersects(pimpl->m_current_viewport)) {
+				to_release.push_back(item);
+				continue;
+			}
 
-		drawdevice = fz_new_draw_device(*ctx, fz_identity, pixmap);
-		fz_run_page(*ctx, *pag, drawdevice, ctm, nullptr);
-		fz_close_device(*ctx, drawdevice);
+			// the tiles of the target level are always kept
+			if (is_layout_key(page, grid, key)) {
+				continue;
+			}
 
-		obj.data = std::unique_ptr<byte>(pixmap->samples); // , size, (unsigned int)pixmap->stride, 96); // default dpi of the pixmap
-		obj.dims = { size_t(w), size_t(h) };
-		obj.size = pixmap->h * pixmap->stride;
-		obj.stride = pixmap->stride;
-		obj.components = pixmap->n;
-		obj.dpi = dpi;
+			auto rec_copy = Geometry::Rectangle(item.recs);
+			rec_copy.width -= m_margin * 3;
+			rec_copy.height -= m_margin * 3;
+			rec_copy.x += m_margin * 3;
+			rec_copy.y += m_margin * 3;
 
-		pixmap->samples = nullptr;
-	} fz_always(*ctx) {
-		fz_drop_device(*ctx, drawdevice);
-		fz_drop_pixmap(*ctx, pixmap);
-	} fz_catch(*ctx) {
-		return Docanto::Image();
+			// Until the target level is drawn the tiles of the other levels fill the gaps. Of those only the nearest
+			// coarser and the nearest finer one is kept, a tile is removed once the levels between it and the target
+			// cover its visible part completely. The pages are transparent, so it would shine through otherwise
+			auto visible = rec_copy.intersection(view);
+			bool covered = visible.width <= 0 or visible.height <= 0;
+			if (key.level < grid.key.level) {
+				for (size_t level = grid.key.level; level > key.level and !covered; level--) {
+					covered = covered_by_level(visible, level);
+				}
+			}
+			else {
+				for (size_t level = grid.key.level; level < key.level and !covered; level++) {
+					covered = covered_by_level(visible, level);
+				}
+			}
+
+			if (covered) {
+				to_release.push_back(item);
+			}
+		}
 	}
 
-	return obj;
+	release_bitmaps(to_release);
+
+	return to_release.size();
 }
 
+size_t Docanto::PDFRenderer::cull_chunks(std::vector<PDFRenderInfo>& chunks, size_t page) {
+	ChromeTrace::Span span("cull chunks", "cull");
+	span.arg("page", static_cast<double>(page)).arg("chunks", static_cast<double>(chunks.size()));
 
-void Docanto::PDFRenderer::position_pdfs() {
-	size_t amount_of_pages = pdf_obj->get_page_count();
-	auto& positions = pimpl->m_page_pos;
+	auto tiles = pimpl->m_tiles.get();
+	auto& page_tiles = tiles->pages.at(page);
+	size_t generation = *pimpl->m_generation;
 
-	float y = 0;
-	for (size_t i = 0; i < amount_of_pages; i++) {
-		auto dims = pdf_obj->get_page_dimension(i);
-		positions.push_back({0, y});
-		y += dims.height + 10;
-	}
-}
+	return std::erase_if(chunks, [&](const PDFRenderInfo& chunk) {
+		// there is already a bitmap of this tile. One that was built from the finer level may not be sharp enough
+		auto bitmap = page_tiles.bitmaps.find(chunk.key);
+		if (bitmap != page_tiles.bitmaps.end() and bitmap->second.dpi != 0.0f and
+			(FLOAT_EQUAL(bitmap->second.dpi, chunk.dpi) or bitmap->second.dpi >= pimpl->m_current_dpi)) {
+			return true;
+		}
 
+		auto job_it = page_tiles.jobs.find(chunk.key);
+		if (job_it == page_tiles.jobs.end()) {
+			return false;
+		}
 
-const std::vector<Docanto::PDFRenderer::PDFRenderInfo>& Docanto::PDFRenderer::get_preview() {
-	auto d =  pimpl->m_previewbitmaps.get_read();
-	return *d.get();
-}
+		auto queue_item = job_it->second;
 
-std::vector<Docanto::Geometry::Rectangle<double>> Docanto::PDFRenderer::get_clipped_page_recs() {
-	size_t amount_of_pages = pdf_obj->get_page_count();
-	auto& positions = pimpl->m_page_pos;
-	std::vector<Docanto::Geometry::Rectangle<double>> recs;
+		// a prefetched tile came into view. If it is still rendering it is taken from the cache once it is
+		// done, else it is queued again with the priority of a visible tile
+		if (queue_item->prefetch) {
+			if (queue_item->status == RenderThreadManager::RenderStatus::PROCESSING and !queue_item->is_stale()) {
+				return true;
+			}
 
-	for (size_t i = 0; i < amount_of_pages; i++) {
-		auto dims = pdf_obj->get_page_dimension(i);
-		Docanto::Geometry::Rectangle<double> rec = { positions[i], dims };
-		if (rec.intersects(pimpl->m_current_viewport)) {
-			recs.push_back(rec);
+			queue_item->cookie.abort = 1;
+			tiles->remove_job(queue_item->info.id);
+			return false;
 		}
-	}
 
-	return recs;
-}
-
-std::vector<Docanto::Geometry::Rectangle<double>> Docanto::PDFRenderer::get_page_recs() {
-	size_t amount_of_pages = pdf_obj->get_page_count();
-	auto& positions = pimpl->m_page_pos;
-	std::vector<Docanto::Geometry::Rectangle<double>> recs;
+		if (queue_item->generation == generation) {
+			return true;
+		}
 
-	for (size_t i = 0; i < amount_of_pages; i++) {
-		auto dims = pdf_obj->get_page_dimension(i);
-		Docanto::Geometry::Rectangle<double> rec = { positions[i], dims };
-		recs.push_back(rec);
-	}
+		// jobs which are already rendering are still needed so they are moved into the current generation
+		if (queue_item->status == RenderThreadManager::RenderStatus::PROCESSING) {
+			queue_item->generation = generation;
+			return true;
+		}
 
-	return recs;
+		// a stale job which is still waiting will be dropped by the render threads, so we queue it again
+		if (queue_item->status == RenderThreadManager::RenderStatus::WAITING) {
+			tiles->remove_job(queue_item->info.id);
+		}
+		return false;
+	});
 }
 
-Docanto::Geometry::Point<float> Docanto::PDFRenderer::get_position(size_t page) {
-	return pimpl->m_page_pos.at(page);
+void Docanto::PDFRenderer::abort_all_items() {
+	pimpl->m_generation->fetch_add(1);
+	thread_manager->abort_stale_jobs();
 }
 
-void Docanto::PDFRenderer::set_position(size_t page, Geometry::Point<float> pos) {
-	pimpl->m_page_pos.at(page) = pos;
-}
+/// <summary>
+/// Calculates how urgent a tile is. Tiles close to the center of the viewport come first, content
+/// is rendered before annotations and pages which fill most of the viewport are preferred.
+/// </summary>
+/// <returns>The priority of the tile, lower values are more urgent</returns>
+float get_tile_priority(const Docanto::Geometry::Rectangle<float>& viewport, const Docanto::Geometry::Rectangle<float>& page_rec, const Docanto::Geometry::Rectangle<float>& tile_rec, bool annotation) {
+	auto half_diagonal = std::max(viewport.dims().width, viewport.dims().height) / 2.0f;
+	auto distance = (tile_rec.center() - viewport.center()).distance() / std::max(half_diagonal, 1.0f);
 
-Docanto::Geometry::Dimension<float> Docanto::PDFRenderer::get_max_dimension() {
-	Docanto::Geometry::Dimension<float> dim = { 0, 0 };
-	for (size_t i = 0; i < pdf_obj->get_page_count(); i++) {
-		auto d = pdf_obj->get_page_dimension(i);
-		dim.width = std::max(dim.width, d.width);
-		dim.height = std::max(dim.height, d.height);
-	}
-	return dim;
+	auto visible = page_rec.intersection(viewport);
+	auto coverage = (visible.width * visible.height) / std::max(viewport.width * viewport.height, 1.0f);
+
+	return distance + (1.0f - coverage) * 0.5f + (annotation ? 0.5f : 0.0f);
 }
 
+void Docanto::PDFRenderer::request(Geometry::Rectangle<float> view, float target_dpi) {
+	ChromeTrace::Span span("request", "ui");
+	span.arg("dpi", target_dpi);
 
-Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> Docanto::PDFRenderer::draw() {
-	return pimpl->m_highDefBitmaps.get_read();
-}
+	if (m_viewport_trace != nullptr) {
+		m_viewport_trace->record_request(id, view, target_dpi);
+	}
 
-Docanto::ReadWrapper<std::vector<Docanto::PDFRenderer::PDFRenderInfo>> Docanto::PDFRenderer::annot() {
-	return pimpl->m_annotationBitmaps.get_read();
-}
+	auto q_lock = pimpl->m_tiles.get();
+	std::vector<std::shared_ptr<RenderThreadManager::RenderJob>> new_jobs;
 
+	// a new viewport makes every queued job stale in one step. The jobs that are still needed
+	// are either moved into the new generation or queued again by cull_chunks
+	bool viewport_changed = !FLOAT_EQUAL(pimpl->m_current_dpi, target_dpi) or
+		!FLOAT_EQUAL(pimpl->m_current_viewport.x, view.x) or !FLOAT_EQUAL(pimpl->m_current_viewport.y, view.y) or
+		!FLOAT_EQUAL(pimpl->m_current_viewport.width, view.width) or !FLOAT_EQUAL(pimpl->m_current_viewport.height, view.height);
+	size_t generation = viewport_changed ? pimpl->m_generation->fetch_add(1) + 1 : pimpl->m_generation->load();
 
-void Docanto::PDFRenderer::remove_from_processor(size_t image_id) {
-	auto vec = pimpl->m_highDefBitmaps.get_write();
-	std::erase_if(*vec, [image_id](const auto& obj) {
-		return obj.id == image_id;
-	});
+	auto previous_view = pimpl->m_current_viewport;
+	auto previous_dpi = pimpl->m_current_dpi;
+	pimpl->m_current_viewport = view;
+	pimpl->m_current_dpi = target_dpi;
 
-	vec = pimpl->m_annotationBitmaps.get_write();
-	std::erase_if(*vec, [image_id](const auto& obj) {
-		return obj.id == image_id;
-	});
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto&        positions = pimpl->m_page_pos;
+	std::vector<bool> visible_pages(amount_of_pages, false);
 
-	m_processor->deleteImage(image_id);
-}
+	// the display lists of a page are built by the render threads the first time they are needed
+	auto queue_list_build = [&](size_t page, float priority) {
+		auto job = pimpl->queue_list_build(page, priority, false);
+		if (job != nullptr) {
+			new_jobs.push_back(job);
+		}
+	};
 
-void Docanto::PDFRenderer::add_to_processor() {
-	// TODO
-}
+	size_t first_visible = amount_of_pages;
+	size_t last_visible = 0;
 
-size_t Docanto::PDFRenderer::cull_bitmaps(ThreadSafeVector<PDFRenderInfo>& info, size_t page, float dpi) {
-	auto vec = info.get_write();
-	std::vector<size_t> ids_to_delete;
-	size_t amount = 0;
-	auto queue_empty = pimpl->m_jobs.get()->empty();
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		auto dims = pdf_obj->get_page_dimension(i);
 
-	for (auto it = vec->rbegin(); it != vec->rend(); it++) {
-		auto& item = *it;
+		auto pdf_rec = Geometry::Rectangle<float>(positions.at(i), dims);
 
-		// skip items from the wrong page
-		if (item.page != page) {
+		// skip pdfs which are currently not visible
+		if (!pdf_rec.intersects(pimpl->m_current_viewport)) {
 			continue;
 		}
+		visible_pages.at(i) = true;
+		first_visible = std::min(first_visible, i);
+		last_visible = std::max(last_visible, i);
 
-		bool intersetcts = (item.recs + get_position(item.page)).intersects(pimpl->m_current_viewport);
+		// the display lists are shared by all jobs of the page
+		auto content_list = pimpl->m_page_content.get_read()->at(i);
+		auto annotat_list = pimpl->m_page_annotat.get_read()->at(i);
 
-		// if its intersects with the viewport and is the target dpi we want to keep it
-		if (intersetcts and // intersection test
-			(FLOAT_EQUAL(item.dpi, dpi)) /*dpi test*/) {
+		// until the lists exist the page is shown as a placeholder. They are built before any tile
+		if (content_list == nullptr or annotat_list == nullptr) {
+			queue_list_build(i, -1.0f);
 			continue;
 		}
 
-		// else we remove any item that is not our target
-		if (queue_empty) {
-			goto ADD_ID_TO_DELETE;
+		auto grid = get_target_grid(i, pimpl->m_current_dpi);
+		auto content_chunks = get_chunks(i, pimpl->m_current_viewport, grid);
+		auto anntoation_chunks = content_chunks;
+		for (auto& chunk : anntoation_chunks) {
+			chunk.key.layer = static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
+		}
+
+		cull_chunks(content_chunks, i);
+		cull_chunks(anntoation_chunks, i);
+
+		// tiles which were rendered before only have to be shown again
+		take_from_cache(content_chunks, pimpl->m_highDefBitmaps);
+		take_from_cache(anntoation_chunks, pimpl->m_annotationBitmaps);
+		take_from_disk(content_chunks);
+		// when zooming out the tiles can be built from the ones that were just shown
+		take_from_mips(content_chunks, pimpl->m_highDefBitmaps);
+		take_from_mips(anntoation_chunks, pimpl->m_annotationBitmaps);
+
+		auto queue = pimpl->m_tiles.get();
+		auto add_job = [&](RenderThreadManager::ContentType type, const PDFRenderInfo& chunk) -> void {
+			auto job = std::make_shared<RenderThreadManager::RenderJob>();
+			job->chunk_rec = chunk.recs;
+			job->info = chunk;
+			job->status = RenderThreadManager::RenderStatus::WAITING;
+			job->type = type;
+
+			job->info.id = thread_manager->m_last_id.fetch_add(1);
+			job->priority = get_tile_priority(pimpl->m_current_viewport, pdf_rec, chunk.recs + positions.at(i), type == RenderThreadManager::ContentType::ANNOTATION);
+
+			job->job = RenderThreadManager::JobType::RENDER_BITMAP;
+			job->list = type == RenderThreadManager::ContentType::ANNOTATION ? annotat_list : content_list;
+			job->generation = generation;
+			job->renderer_generation = pimpl->m_generation;
+			queue->add_job(job);
+			new_jobs.push_back(job);
+		};
+
+		for (auto& chunk : content_chunks) {
+			// add the new chunks to the queue
+			add_job(RenderThreadManager::ContentType::CONTENT, chunk);
 		}
 
-		// else we can check if they are already overlapping in a way with our target that we can remove it
-		if (!intersetcts) {
-			goto ADD_ID_TO_DELETE;
+		for (auto& chunk : anntoation_chunks) {
+			// add the new chunks to the queue
+			add_job(RenderThreadManager::ContentType::ANNOTATION, chunk);
 		}
 
-		// if it intersects with the viewport but is not our desired dpi we need to do further checks
-		// check if its intersects with other recs which have our target dpi
-		for (auto it2 = vec->rbegin(); it2 != vec->rend(); it2++) {
-			if (it == it2) {
-				continue;
+		cull_bitmaps(pimpl->m_highDefBitmaps, i, grid);
+		cull_bitmaps(pimpl->m_annotationBitmaps, i, grid);
+	}
+
+	pimpl->m_visible_pages.clear();
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		if (visible_pages.at(i)) {
+			pimpl->m_visible_pages.push_back(i);
+		}
+	}
+
+	// the pages right before and after the viewport are prepared in the background
+	if (first_visible <= last_visible) {
+		for (size_t d = 1; d <= m_list_prefetch_pages; d++) {
+			if (first_visible >= d) {
+				queue_list_build(first_visible - d, 5.0f + d);
 			}
-				
-			// we only want to look at the bitmaps which have our target dpi
-			if (!FLOAT_EQUAL(it2->dpi, dpi)) {
-				continue;
+			if (last_visible + d < amount_of_pages) {
+				queue_list_build(last_visible + d, 5.0f + d);
 			}
+		}
+	}
 
-			auto rec_copy = Geometry::Rectangle(item.recs);
-			rec_copy.width -= m_margin * 3;
-			rec_copy.height -= m_margin * 3;
-			rec_copy.x += m_margin * 3;
-			rec_copy.y += m_margin * 3;
+	// the bitmaps of pages which left the viewport are not drawn anymore and can be evicted
+	std::vector<PDFRenderInfo> hidden;
+	for (size_t i = 0; i < amount_of_pages; i++) {
+		if (visible_pages.at(i)) {
+			continue;
+		}
 
-			// if we have a higher dpi bitmap and a bitmap at target dpi over it we can remove the higher dpi one
-			if (item.dpi > it2->dpi and rec_copy.intersects(it2->recs)) {
-				goto ADD_ID_TO_DELETE;
-			}
+		for (const auto& [_, item] : q_lock->pages.at(i).bitmaps) {
+			hidden.push_back(item);
 		}
+	}
+	release_bitmaps(hidden);
+	evict_tiles();
 
-		// if the queue is not empty, it intersects and does overlap with an target we dont remove it
-		continue;
+	if (viewport_changed or pimpl->m_previews_dirty) {
+		pimpl->m_previews_dirty = false;
+		request_previews();
+	}
+
+	// jobs which are rendering but are not needed anymore can be stopped
+	if (viewport_changed) {
+		thread_manager->abort_stale_jobs();
+	}
+
+	// the jobs of all pages are added at once so the most urgent ones are started first
+	pimpl->queue_jobs(id, new_jobs);
+
+	request_prefetch(previous_view, previous_dpi, viewport_changed);
+	notify_completion();
+}
+
+void Docanto::PDFRenderer::request_prefetch(const Geometry::Rectangle<float>& previous_view, float previous_dpi, bool viewport_changed) {
+	auto tiles = pimpl->m_tiles.get();
+	auto& motion = pimpl->m_motion;
+	const auto& view = pimpl->m_current_viewport;
+	float dt = motion.last_change.delta_us() / 1000000.0f;
+
+	if (viewport_changed and previous_view.width > 0 and previous_view.height > 0) {
+		motion.last_change = Timer();
+
+		// after a pause the motion starts over, else it is smoothed over the last requests
+		float blend = dt > m_prefetch_pause ? 1.0f : 0.5f;
+		dt = std::max(dt, 0.001f);
+
+		auto velocity = (view.center() - previous_view.center()) / dt;
+		auto zoom_velocity = std::log2(pimpl->m_current_dpi / std::max(previous_dpi, 1.0f)) / dt;
+		motion.velocity = motion.velocity * (1.0f - blend) + velocity * blend;
+		motion.zoom_velocity = motion.zoom_velocity * (1.0f - blend) + zoom_velocity * blend;
+	}
+	else if (dt > m_prefetch_pause) {
+		motion.velocity = { 0, 0 };
+		motion.zoom_velocity = 0;
+	}
+
+	float view_size = std::max({ view.width, view.height, 1.0f });
+	float speed = motion.velocity.distance();
+	auto direction = speed / view_size >= m_prefetch_min_speed ? motion.velocity / speed : Geometry::Point<float>(0, 0);
+	int zoom = std::abs(motion.zoom_velocity) < m_prefetch_min_zoom_speed ? 0 : (motion.zoom_velocity > 0 ? 1 : -1);
+
+	// the prefetch jobs are canceled once the viewport turns by more than 45 degrees or the zoom trend changes
+	auto& last = motion.prefetch_direction;
+	bool moving = direction.x != 0 or direction.y != 0;
+	bool was_moving = last.x != 0 or last.y != 0;
+	bool same_direction = moving == was_moving and (!moving or direction.x * last.x + direction.y * last.y > 0.7f);
+
+	if (!same_direction or zoom != motion.prefetch_zoom) {
+		pimpl->m_prefetch_generation->fetch_add(1);
+		thread_manager->abort_stale_jobs();
+
+		std::vector<size_t> to_remove;
+		for (const auto& [job_id, job] : tiles->jobs) {
+			if (job->prefetch) {
+				to_remove.push_back(job_id);
+			}
+		}
+		for (auto job_id : to_remove) {
+			tiles->remove_job(job_id);
+		}
 
-		// else remove it
-	ADD_ID_TO_DELETE:
-		ids_to_delete.push_back(item.id);
-		amount++;
-		
+		motion.prefetch_direction = direction;
+		motion.prefetch_zoom = zoom;
 	}
 
-	for (auto ids : ids_to_delete) {
-		remove_from_processor(ids);
+	if ((!moving and zoom == 0) or pimpl->m_prefetch_budget == 0 or m_prefetch_lookahead <= 0) {
+		return;
 	}
 
-	return amount;
-}
-
-size_t Docanto::PDFRenderer::cull_chunks(std::vector<Geometry::Rectangle<float>>& chunks, size_t page, ThreadSafeVector<PDFRenderInfo>& info) {
-	// TODO we also should look into the queue
-	auto render_queue = pimpl->m_jobs.get();
-	auto bitmaps = info.get_read();
-
-	size_t amount = 0;
-	auto position = pimpl->m_page_pos.at(page);
+	// the area the viewport will cover in the next moments, at the dpi it will have by then
+	std::vector<std::pair<Geometry::Rectangle<float>, float>> areas;
+	if (moving) {
+		auto shift = direction * std::min(speed * m_prefetch_lookahead, view_size * 2);
+		auto ahead = Geometry::Rectangle<float>(view.upperleft() + shift, view.lowerright() + shift);
+		areas.push_back({ Geometry::Rectangle<float>(
+			Geometry::Point<float>(std::min(view.x, ahead.x), std::min(view.y, ahead.y)),
+			Geometry::Point<float>(std::max(view.right(), ahead.right()), std::max(view.bottom(), ahead.bottom()))
+		), pimpl->m_current_dpi });
+	}
+	if (zoom != 0) {
+		// zooming in shows half of the viewport at twice the dpi, zooming out the opposite
+		float factor = zoom > 0 ? 0.5f : 2.0f;
+		auto half = Geometry::Point<float>(view.width, view.height) * (factor / 2);
+		areas.push_back({ Geometry::Rectangle<float>(view.center() - half, view.center() + half), pimpl->m_current_dpi / factor });
+	}
 
-	for (auto it = chunks.begin(); it != chunks.end();) {
-		bool del = false;
-		auto chunk = *it;
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	auto& positions = pimpl->m_page_pos;
+	std::vector<std::shared_ptr<RenderThreadManager::RenderJob>> new_jobs;
+	std::vector<std::pair<float, PDFRenderInfo>> candidates;
 
-		// loop over all bitmaps to see if there are any which are already the same 
-		for (size_t j = 0; j < bitmaps->size(); j++) {
-			auto bitma = bitmaps->at(j);
+	auto center = view.center();
+	auto get_distance = [&](const Geometry::Rectangle<float>& rec) {
+		return (rec.center() - center).distance() / view_size;
+	};
 
-			if (bitma.page != page or bitma.dpi == 0.0f) {
+	for (const auto& [area, dpi] : areas) {
+		for (size_t i = 0; i < amount_of_pages; i++) {
+			auto pdf_rec = Geometry::Rectangle<float>(positions.at(i), pdf_obj->get_page_dimension(i));
+			if (!pdf_rec.intersects(area)) {
 				continue;
 			}
 
-			if (FLOAT_EQUAL(chunk.x, bitma.recs.x) and FLOAT_EQUAL(chunk.y, bitma.recs.y) and
-				FLOAT_EQUAL(chunk.width, bitma.recs.width) and FLOAT_EQUAL(chunk.width, bitma.recs.width)) {
-				del = true;
-				goto DONE;
-			}
-		}
-
-		for (size_t j = 0; j < render_queue->size(); j++) {
-			auto queue_item = render_queue->at(j);
-
-			// only consider the queue items which are on the correct page
-			if (queue_item->info.page != page) {
+			// the display lists are prefetched as well. They are needed before any tile of the page
+			if (pimpl->m_page_content.get_read()->at(i) == nullptr or pimpl->m_page_annotat.get_read()->at(i) == nullptr) {
+				auto job = pimpl->queue_list_build(i, 20.0f + get_distance(pdf_rec), true);
+				if (job != nullptr) {
+					new_jobs.push_back(job);
+				}
 				continue;
 			}
 
-			if (FLOAT_EQUAL(chunk.x, queue_item->chunk_rec.x) and FLOAT_EQUAL(chunk.y, queue_item->chunk_rec.y) and
-				FLOAT_EQUAL(chunk.width, queue_item->chunk_rec.width) and FLOAT_EQUAL(chunk.width, queue_item->chunk_rec.width)) {
-				del = true;
-				goto DONE;
-			}
-		}
+			auto current_zoom = get_target_grid(i, pimpl->m_current_dpi).key.zoom;
+			auto grid = get_tile_grid(i, dpi);
+			// the layouts are only read, changing them would drop the jobs the viewport is waiting for
+			auto chunks = get_chunks(i, area, grid, false);
+
+			for (const auto& chunk : chunks) {
+				// the visible tiles at the current dpi are already queued by request
+				if (grid.key.zoom == current_zoom and (chunk.recs + positions.at(i)).intersects(view)) {
+					continue;
+				}
 
+				candidates.push_back({ get_distance(chunk.recs + positions.at(i)), chunk });
 
-	DONE:
-		if (del) {
-			amount++;
-			chunks.erase(it);
-			it = chunks.begin();
-		}
-		else {
-			it++;
+				auto annotation = chunk;
+				annotation.key.layer = static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
+				candidates.push_back({ candidates.back().first + 0.5f, annotation });
+			}
 		}
 	}
-	
-	return amount;
-}
 
-void Docanto::PDFRenderer::abort_all_items() {
-	auto queue = pimpl->m_jobs.get();
-	for (auto& q : *queue) {
-		q->cookie.abort = 1;
-	}
+	std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+		return a.first < b.first;
+	});
 
-}
+	// before a tile is rendered we can only estimate its size, 4 bytes per pixel
+	auto estimate_bytes = [](const PDFRenderInfo& info) {
+		float scale = info.dpi / MUPDF_DEFAULT_DPI;
+		return static_cast<size_t>(std::ceil(info.recs.width * scale) * std::ceil(info.recs.height * scale) * 4);
+	};
 
-size_t Docanto::PDFRenderer::abort_queue_item(size_t page, float dpi) {
-	auto queue = pimpl->m_jobs.get();
-	size_t amount = 0;
+	// the prefetched tiles which were not drawn yet count against the budget as well
+	size_t planned_bytes = pimpl->m_tile_cache.get_prefetched_bytes();
+	for (const auto& [_, job] : tiles->jobs) {
+		if (job->prefetch and job->job == RenderThreadManager::JobType::RENDER_BITMAP) {
+			planned_bytes += estimate_bytes(job->info);
+		}
+	}
 
-	for (auto it = queue->begin(); it != queue->end(); it++) {
-		auto& item = *it;
+	auto content = pimpl->m_page_content.get_read();
+	auto annotat = pimpl->m_page_annotat.get_read();
 
-		if (item->info.page != page) {
+	for (const auto& [distance, chunk] : candidates) {
+		auto& page_tiles = tiles->pages.at(chunk.page);
+		if (page_tiles.bitmaps.contains(chunk.key) or page_tiles.jobs.contains(chunk.key) or
+			pimpl->m_tile_cache.contains(chunk.key) or pimpl->is_on_disk(chunk.key)) {
 			continue;
 		}
 
-		if ((item->info.recs + get_position(item->info.page)).intersects(pimpl->m_current_viewport) and // intersection test
-			(FLOAT_EQUAL(item->info.dpi, dpi)) /*dpi test*/) {
-			continue;
+		planned_bytes += estimate_bytes(chunk);
+		if (planned_bytes > pimpl->m_prefetch_budget) {
+			break;
 		}
 
-		amount++;
-
-		item->cookie.abort = 1;
+		bool is_annotation = chunk.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
+
+		auto job = std::make_shared<RenderThreadManager::RenderJob>();
+		job->chunk_rec = chunk.recs;
+		job->info = chunk;
+		job->info.id = thread_manager->m_last_id.fetch_add(1);
+		job->status = RenderThreadManager::RenderStatus::WAITING;
+		job->type = is_annotation ? RenderThreadManager::ContentType::ANNOTATION : RenderThreadManager::ContentType::CONTENT;
+
+		// the prefetch is rendered after the visible tiles and the previews
+		job->priority = 20.0f + distance;
+
+		job->job = RenderThreadManager::JobType::RENDER_BITMAP;
+		job->list = is_annotation ? annotat->at(chunk.page) : content->at(chunk.page);
+		job->prefetch = true;
+		job->generation = pimpl->m_prefetch_generation->load();
+		job->renderer_generation = pimpl->m_prefetch_generation;
+		tiles->add_job(job);
+		new_jobs.push_back(job);
 	}
 
-	return amount;
+	pimpl->queue_jobs(id, new_jobs);
 }
 
-size_t Docanto::PDFRenderer::remove_finished_queue_item() {
-	auto queue = pimpl->m_jobs.get();
-	std::erase_if(*queue, [](std::shared_ptr<RenderThreadManager::RenderJob> info) -> bool {
-		return info->cookie.abort == 1;
-	});
+void Docanto::PDFRenderer::set_rendercallback(std::function<void(size_t)> fun) { m_render_callback = fun; }
 
-	return 0;
-}
+void Docanto::PDFRenderer::set_render_notifier(std::shared_ptr<PDFRenderNotifier> notifier) {
+	if (m_render_notifier != nullptr) {
+		m_render_notifier->remove_source(id);
+	}
 
-void Docanto::PDFRenderer::request(Geometry::Rectangle<float> view, float target_dpi) {
-	auto q_lock = pimpl->m_jobs.get();
+	m_render_notifier = notifier;
+	notify_completion();
+}
 
-	pimpl->m_current_viewport = view;
-	pimpl->m_current_dpi = target_dpi;
+void Docanto::PDFRenderer::set_viewport_trace(std::shared_ptr<PDFViewportTrace> trace) {
+	m_viewport_trace = trace;
+	if (trace == nullptr) {
+		return;
+	}
 
-	remove_finished_queue_item();
+	trace->add_document(id, pdf_obj->path);
+	for (size_t i = 0; i < pimpl->m_page_pos.size(); i++) {
+		trace->record_position(id, i, pimpl->m_page_pos.at(i));
+	}
+}
 
-	size_t amount_of_pages = pdf_obj->get_page_count();
-	auto&        positions = pimpl->m_page_pos;
 
+void Docanto::PDFRenderer::receive_image(PDFRenderInfo info, Image&& i, uint64_t render_us) {
+	ChromeTrace::Span span("receive image");
+	span.arg("page", static_cast<double>(info.page)).arg("bytes", static_cast<double>(i.size));
 
-	for (size_t i = 0; i < amount_of_pages; i++) {
-		auto dims = pdf_obj->get_page_dimension(i);
+	// the cost does not depend on the viewport, so stale tiles are measured as well
+	record_cost(info, render_us, i.dims.width * i.dims.height);
 
-		auto pdf_rec = Geometry::Rectangle<float>(positions.at(i), dims);
+	// the content does not depend on the viewport, so even tiles of stale jobs are worth keeping.
+	// The file is written before the index is locked
+	std::shared_ptr<PDFDiskTileCache> disk_cache;
+	std::optional<ImageTarget::PixelFormat> target;
+	bool is_live = false;
+	{
+		auto tiles = pimpl->m_tiles.get();
+		disk_cache = pimpl->m_disk_cache;
+		is_live = tiles->jobs.contains(info.id);
 
-		// skip pdfs which are currently not visible
-		if (!pdf_rec.intersects(pimpl->m_current_viewport)) {
-			continue;
+		auto it = tiles->targets.find(info.id);
+		if (it != tiles->targets.end()) {
+			target = it->second;
 		}
+	}
+	// the disk cache only holds rgba tiles
+	bool is_rgba = !target.has_value() or target.value() == ImageTarget::PixelFormat::RGBA;
+	if (disk_cache != nullptr and is_rgba and info.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::CONTENT)) {
+		disk_cache->store(pimpl->get_disk_key(info.key), i);
+	}
 
-		auto [content_chunks, dpi] = get_chunks(i);
-		auto [anntoation_chunks, _] = get_chunks(i);
-		abort_queue_item(i, dpi);
+	// the tiles are downsampled while the pixels are still there, the processor may upload them once they are committed.
+	// The tiles of jobs which were dropped are not used, so they are not downsampled
+	std::optional<Image> mip;
+	bool is_tile = info.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::CONTENT) or
+		info.key.layer == static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
+	if (is_live and is_tile and info.key.level > 0 and pimpl->m_mips.get()->budget != 0) {
+		mip = downsample_image(i, !is_rgba);
+	}
 
-		// check for any missing display lists
-		if (!thread_manager->has_display_list(id, i, RenderThreadManager::ContentType::CONTENT)) {
-			auto job = std::make_shared<RenderThreadManager::RenderJob>();
-			job->job = RenderThreadManager::JobType::LOAD_DISPLAY_LIST;
-			job->info.page = i;
+	// now check what type it is
+	auto q = pimpl->m_tiles.get();
+	auto iter = q->jobs.find(info.id);
 
-			// load page content
-			job->list = pimpl->m_page_content.get_read()->at(i);
-			job->type = RenderThreadManager::ContentType::CONTENT;
+	auto kind = impl::get_job_kind(RenderThreadManager::JobType::RENDER_BITMAP, info);
 
-			thread_manager->add_job(id, job);
+	// the job became stale and was already queued again while it was rendering
+	if (iter == q->jobs.end()) {
+		pimpl->m_stats.add_wasted(kind);
+		if (q->targets.erase(info.id) != 0) {
+			m_processor->cancelImage(info.id);
 		}
+		return;
+	}
 
-		if (!thread_manager->has_display_list(id, i, RenderThreadManager::ContentType::ANNOTATION)) {
-			auto job = std::make_shared<RenderThreadManager::RenderJob>();
-			job->job = RenderThreadManager::JobType::LOAD_DISPLAY_LIST;
-			job->info.page = i;
-
-			// load annotation content
-			job->list = pimpl->m_page_annotat.get_read()->at(i);
-			job->type = RenderThreadManager::ContentType::ANNOTATION;
-
-			thread_manager->add_job(id, job);
+	// add the new image to the list
+	if (q->targets.erase(info.id) != 0) {
+		// mupdf failed to draw the tile, it will be requested again
+		if (i.data == nullptr) {
+			pimpl->m_stats.add_wasted(kind);
+			m_processor->cancelImage(info.id);
+			q->remove_job(info.id);
+			return;
 		}
-		
-		cull_chunks(content_chunks, i, pimpl->m_highDefBitmaps);
-		cull_chunks(anntoation_chunks, i, pimpl->m_annotationBitmaps);
-
-		auto queue = pimpl->m_jobs.get();
-		auto add_job = [&](RenderThreadManager::ContentType type, Geometry::Rectangle<float> r) -> void {
-			auto job = std::make_shared<RenderThreadManager::RenderJob>();
-			job->chunk_rec = r;
-			job->info.page = i;
-			job->status = RenderThreadManager::RenderStatus::WAITING;
-			job->type = type;
 
-			job->info.dpi = dpi;
-			job->info.id = thread_manager->m_last_id.fetch_add(1);
-			job->info.recs = { r.upperleft(), r.dims()};
+		m_processor->commitImage(info.id);
+	}
+	else {
+		m_processor->processImage(info.id, i);
+	}
 
-			job->job = RenderThreadManager::JobType::RENDER_BITMAP;
-			queue->push_front(job);
-			thread_manager->add_job(id, job);
-		};
+	if (mip.has_value()) {
+		store_mip(info, std::move(mip.value()));
+	}
 
-		for (auto& chunk_rec : content_chunks) {
-			// add the new chunks to the queue
-			add_job(RenderThreadManager::ContentType::CONTENT, chunk_rec);
-		}
+	pimpl->m_stats.add_completed(kind);
+	pimpl->m_stats.add_render_time(render_us);
 
-		for (auto& chunk_rec : anntoation_chunks) {
-			// add the new chunks to the queue
-			add_job(RenderThreadManager::ContentType::ANNOTATION, chunk_rec);
-		}
+	// the previews are not part of the tile cache
+	if (iter->second->type == RenderThreadManager::ContentType::PREVIEW) {
+		auto& page_tiles = q->pages.at(info.page);
+		page_tiles.preview = info;
+		page_tiles.preview_bytes = i.size;
+		pimpl->m_previewbitmaps.get_write()->push_back(info);
+		q->remove_job(info.id);
 
-		cull_bitmaps(pimpl->m_highDefBitmaps, i, dpi);
-		cull_bitmaps(pimpl->m_annotationBitmaps, i, dpi);
+		notify_rendered(info.id, info.recs + get_position(info.page));
+		return;
 	}
 
+	// prefetched tiles are only cached, they are drawn once the viewport reaches them
+	if (iter->second->prefetch) {
+		auto& page_bitmaps = q->pages.at(info.page).bitmaps;
+		auto drawn = page_bitmaps.find(info.key);
 
+		auto replaced = pimpl->m_tile_cache.insert(info.key, info.id, i.size, false);
+		if (replaced.has_value() and (drawn == page_bitmaps.end() or drawn->second.id != replaced.value())) {
+			m_processor->deleteImage(replaced.value());
+		}
 
-}
-
-void Docanto::PDFRenderer::set_rendercallback(std::function<void(size_t)> fun) { m_render_callback = fun; }
-
+		q->remove_job(info.id);
+		evict_tiles();
 
-void Docanto::PDFRenderer::receive_image(PDFRenderInfo info, Image&& i) {
-	// add the new image to the list
-	m_processor->processImage(info.id, i);
+		// the viewport may have reached the tile while it was rendering
+		if ((info.recs + get_position(info.page)).intersects(pimpl->m_current_viewport))
+			notify_rendered(info.id, info.recs + get_position(info.page));
+		return;
+	}
 
-	// now check what type it is
-	auto q = pimpl->m_jobs.get();
-	auto iter = std::find_if(q->begin(), q->end(), [&info](std::shared_ptr<RenderThreadManager::RenderJob> item) -> bool {
-		return item->info.id == info.id;
-	});
+	// an outdated bitmap of the same tile is replaced by the new one
+	std::vector<PDFRenderInfo> outdated;
+	auto& page_bitmaps = q->pages.at(info.page).bitmaps;
+	auto drawn = page_bitmaps.find(info.key);
+	if (drawn != page_bitmaps.end() and drawn->second.id != info.id) {
+		outdated.push_back(drawn->second);
+	}
 
-	if (iter == q->end()) {
-		Logger::error("In receive image: Received an image which was not found in the queue (but how did we send it?)");
-		pimpl->m_highDefBitmaps.get_write()->push_back(info);
-		return;
+	auto replaced = pimpl->m_tile_cache.insert(info.key, info.id, i.size);
+	if (replaced.has_value() and (outdated.empty() or outdated.front().id != replaced.value())) {
+		m_processor->deleteImage(replaced.value());
 	}
 
-	if ((*iter)->type == RenderThreadManager::ContentType::ANNOTATION) {
+	if (iter->second->type == RenderThreadManager::ContentType::ANNOTATION) {
 		pimpl->m_annotationBitmaps.get_write()->push_back(info);
 	}
 	else {
@@ -917,11 +3484,31 @@ void Docanto::PDFRenderer::receive_image(PDFRenderInfo info, Image&& i) {
 	}
 
 	// we can then remove it from the queue
-	q->erase(iter);
+	q->remove_job(info.id);
+	q->add_bitmap(info);
+	release_bitmaps(outdated);
+	evict_tiles();
+
+	// the notifier has to know about the completion before the last tile arrives
+	notify_completion();
+	notify_rendered(info.id, info.recs + get_position(info.page));
+}
 
-	// call the callback
+void Docanto::PDFRenderer::notify_rendered(size_t image_id, const Geometry::Rectangle<float>& rec) {
 	if (m_render_callback)
-		m_render_callback(info.id);
+		m_render_callback(image_id);
+
+	if (m_render_notifier != nullptr)
+		m_render_notifier->add(id, image_id, rec);
+}
+
+void Docanto::PDFRenderer::notify_completion() {
+	if (m_render_notifier == nullptr) {
+		return;
+	}
+
+	auto tiles = pimpl->m_tiles.get();
+	m_render_notifier->set_complete(id, pimpl->is_view_complete(*tiles));
 }
 
 void Docanto::PDFRenderer::debug_draw(std::shared_ptr<BasicRender> render) {
@@ -936,11 +3523,10 @@ void Docanto::PDFRenderer::debug_draw(std::shared_ptr<BasicRender> render) {
 
 		if (pdf_rec.intersects(pimpl->m_current_viewport)) {
 			amount++;
-			auto [recs, _] = get_chunks(i);
+			auto recs = get_chunks(i, pimpl->m_current_viewport, get_target_grid(i, pimpl->m_current_dpi));
 
 			for (auto& r : recs) {
-				r = { r.upperleft() + positions.at(i), Geometry::Dimension<float>(r.dims())};
-				render->draw_rect(r, { 0, 255 });
+				render->draw_rect(r.recs + positions.at(i), { 0, 255 });
 			}
 			render->draw_rect(pdf_rec, { 255 });
 		}
@@ -956,191 +3542,425 @@ void Docanto::PDFRenderer::debug_draw(std::shared_ptr<BasicRender> render) {
 
 }
 
-void Docanto::PDFRenderer::update() {
-	// clear the list and copy all again
-	Logger::log(L"Start creating Display List");
-	Docanto::Timer time;
-	// for each rec create a display list
-	fz_display_list* list_annot = nullptr;
+// records the appearance of a single annotation. Returns nullptr if it could not be recorded
+std::shared_ptr<DisplayListWrapper> record_annotation(fz_context* ctx, pdf_annot* annot, fz_cookie* cookie) {
+	fz_display_list* list = nullptr;
+	fz_device* dev = nullptr;
+	fz_rect bounds = { 0, 0, 0, 0 };
+	bool success = false;
+
+	fz_try(ctx) {
+		bounds = pdf_bound_annot(ctx, annot);
+		list = fz_new_display_list(ctx, bounds);
+		dev = fz_new_list_device(ctx, list);
+		pdf_run_annot(ctx, annot, dev, fz_identity, cookie);
+		fz_close_device(ctx, dev);
+		success = true;
+	} fz_always(ctx) {
+		fz_drop_device(ctx, dev);
+	} fz_catch(ctx) {
+		fz_drop_display_list(ctx, list);
+	}
+
+	if (!success) {
+		return nullptr;
+	}
+
+	auto wrap = std::make_shared<DisplayListWrapper>(list);
+	wrap->bounds = bounds;
+	wrap->annot_num = pdf_to_num(ctx, pdf_annot_obj(ctx, annot));
+	return wrap;
+}
+
+/// <summary>
+/// Records the annotation layer of the page as one list per annotation. The lists of annotations which
+/// are part of the previous layer and whose appearance did not change are reused, so adding or removing
+/// a single annotation only records that annotation. Every annotation is still passed to pdf_update_annot
+/// to find out if it changed.
+/// </summary>
+/// <param name="previous">The last layer of the page, can be nullptr</param>
+/// <returns>The new layer, nullptr if the recording was aborted</returns>
+std::shared_ptr<DisplayListWrapper> record_annotation_layer(fz_context* ctx, fz_page* page, const DisplayListWrapper* previous, fz_cookie* cookie) {
+	// new annotations get new object numbers, so a number always belongs to the same annotation
+	std::unordered_map<int, std::shared_ptr<DisplayListWrapper>> recorded;
+	if (previous != nullptr) {
+		for (const auto& piece : previous->pieces) {
+			if (piece->annot_num != 0) {
+				recorded[piece->annot_num] = piece;
+			}
+		}
+	}
+
+	std::vector<std::shared_ptr<DisplayListWrapper>> pieces;
+	for (auto annot = pdf_first_annot(ctx, reinterpret_cast<pdf_page*>(page)); annot != nullptr; annot = pdf_next_annot(ctx, annot)) {
+		// regenerates the appearance if the annotation was changed
+		int changed = 1;
+		fz_try(ctx) {
+			changed = pdf_update_annot(ctx, annot);
+		} fz_catch(ctx) {
+			Docanto::Logger::warn("Could not update the appearance of an annotation");
+		}
+
+		auto it = recorded.find(pdf_to_num(ctx, pdf_annot_obj(ctx, annot)));
+		if (!changed and it != recorded.end()) {
+			pieces.push_back(it->second);
+			continue;
+		}
+
+		auto piece = record_annotation(ctx, annot, cookie);
+		if (cookie != nullptr and cookie->abort) {
+			return nullptr;
+		}
+		if (piece != nullptr) {
+			pieces.push_back(piece);
+		}
+	}
+
+	return std::make_shared<DisplayListWrapper>(std::move(pieces));
+}
+
+/// <summary>
+/// Records the requested display lists of a page. The caller has to make sure no other thread uses the document.
+/// </summary>
+/// <param name="layers">A combination of the PAGE_LAYER_ flags</param>
+/// <returns>The lists, the ones that were not requested are nullptr</returns>
+std::optional<PageDisplayLists> record_page_lists(fz_context* ctx, fz_document* doc, size_t page, int layers, fz_cookie* cookie) {
+	std::shared_ptr<DisplayListWrapper> annot_layer;
 	fz_display_list* list_widget = nullptr;
 	fz_display_list* list_content = nullptr;
-	fz_device* dev_annot = nullptr;
 	fz_device* dev_widget = nullptr;
 	fz_device* dev_content = nullptr;
+	fz_page* p = nullptr;
+	bool success = false;
 
+	fz_try(ctx) {
+		p = fz_load_page(ctx, doc, static_cast<int>(page));
 
-	auto ctx = GlobalPDFContext::get_instance().get();
+		// the appearance of the annotations has to be up to date
+		if (layers & PAGE_LAYER_ANNOTATIONS) {
+			pdf_update_page(ctx, reinterpret_cast<pdf_page*>(p));
+		}
 
-	size_t amount_of_pages = pdf_obj->get_page_count();
-	//m_display_list_amount_processed_total = amount_of_pages;
+		// create a display list with all the draw calls and so on
+		auto bounds = fz_bound_page(ctx, p);
+		if (layers & PAGE_LAYER_ANNOTATIONS) {
+			annot_layer = record_annotation_layer(ctx, p, nullptr, cookie);
+		}
 
-	for (size_t i = 0; i < amount_of_pages; i++) {
-		// get the page that will be rendered
-		auto doc = pdf_obj->get();
-		// we have to do a fz call since we want to use the ctx.
-		// we can't use any other calls (like m_pdf->get_page()) since we would need to create a ctx
-		// wrapper which would be overkill for this scenario.
-		fz_page* p = fz_load_page(*ctx, *doc, static_cast<int>(i));
-		pdf_update_page(*ctx, reinterpret_cast<pdf_page*>(p));
-		fz_try(*ctx) {
-			// create a display list with all the draw calls and so on
-			list_annot = fz_new_display_list(*ctx, fz_bound_page(*ctx, p));
-			list_widget = fz_new_display_list(*ctx, fz_bound_page(*ctx, p));
-			list_content = fz_new_display_list(*ctx, fz_bound_page(*ctx, p));
-
-			dev_annot = fz_new_list_device(*ctx, list_annot);
-			dev_widget = fz_new_list_device(*ctx, list_widget);
-			dev_content = fz_new_list_device(*ctx, list_content);
-
-			// run all three devices
-			Timer time2;
-			fz_run_page_annots(*ctx, p, dev_annot, fz_identity, nullptr);
-			Logger::log("Page ", i + 1, " Annots Rendered in ", time2);
-
-			time2 = Timer();
-			fz_run_page_widgets(*ctx, p, dev_widget, fz_identity, nullptr);
-			Logger::log("Page ", i + 1, " Widgets Rendered in ", time2);
-
-			time2 = Timer();
-			fz_run_page_contents(*ctx, p, dev_content, fz_identity, nullptr);
-			Logger::log("Page ", i + 1, " Content Rendered in ", time2);
-
-			// get the list and add the lists
-			auto content = pimpl->m_page_content.get_write();
-			content->emplace_back(std::make_unique<DisplayListWrapper>(std::move(list_content)));
-
-			auto widgets = pimpl->m_page_widgets.get_write();
-			widgets->emplace_back(std::make_unique<DisplayListWrapper>(std::move(list_widget)));
-
-			auto annotat = pimpl->m_page_annotat.get_write();
-			annotat->emplace_back(std::make_unique<DisplayListWrapper>(std::move(list_annot)));
-
-
-		} fz_always(*ctx) {
-			// flush the device
-			fz_close_device(*ctx, dev_annot);
-			fz_close_device(*ctx, dev_widget);
-			fz_close_device(*ctx, dev_content);
-			fz_drop_device(*ctx, dev_annot);
-			fz_drop_device(*ctx, dev_widget);
-			fz_drop_device(*ctx, dev_content);
-		} fz_catch(*ctx) {
-			Docanto::Logger::error("Could not preprocess the PDF page");
+		if (layers & PAGE_LAYER_WIDGETS) {
+			list_widget = fz_new_display_list(ctx, bounds);
+			dev_widget = fz_new_list_device(ctx, list_widget);
+			fz_run_page_widgets(ctx, p, dev_widget, fz_identity, cookie);
+			fz_close_device(ctx, dev_widget);
 		}
+
+		if (layers & PAGE_LAYER_CONTENT) {
+			list_content = fz_new_display_list(ctx, bounds);
+			dev_content = fz_new_list_device(ctx, list_content);
+			fz_run_page_contents(ctx, p, dev_content, fz_identity, cookie);
+			fz_close_device(ctx, dev_content);
+		}
+
+		// the annotation layer is only missing if the recording was aborted
+		success = annot_layer != nullptr or !(layers & PAGE_LAYER_ANNOTATIONS);
+	} fz_always(ctx) {
+		fz_drop_device(ctx, dev_widget);
+		fz_drop_device(ctx, dev_content);
 		// always drop page at the end
-		fz_drop_page(*ctx, p);
+		fz_drop_page(ctx, p);
+	} fz_catch(ctx) {
+		if (cookie == nullptr or cookie->abort == 0) {
+			Docanto::Logger::error("Could not preprocess the PDF page ", page + 1);
+		}
+		fz_drop_display_list(ctx, list_widget);
+		fz_drop_display_list(ctx, list_content);
+	}
+
+	if (!success) {
+		return std::nullopt;
 	}
 
-	Logger::log(L"Finished Displaylist in ", time);
+	auto wrap = [](fz_display_list* list) {
+		return list == nullptr ? nullptr : std::make_shared<DisplayListWrapper>(list);
+	};
+
+	return PageDisplayLists{ wrap(list_content), wrap(list_widget), annot_layer };
 }
 
-void Docanto::PDFRenderer::update_page_annotations(size_t page) {
-	// clear the list and copy all again
-	Docanto::Timer time;
-	// for each rec create a display list
-	fz_display_list* list_annot = nullptr;
-	fz_device* dev_annot = nullptr;
+std::optional<PageDisplayLists> build_page_lists(fz_context* ctx, Docanto::PDF& pdf, size_t page, fz_cookie* cookie) {
+	// the document can only be used by one thread at a time. No other lock may be taken while
+	// holding it, since the global context is locked before the document everywhere else
+	auto doc = pdf.get();
+	return record_page_lists(ctx, *doc, page, PAGE_LAYER_ALL, cookie);
+}
 
-	auto ctx = GlobalPDFContext::get_instance().get();
+void Docanto::PDFRenderer::update() {
+	// builds the lists of every page right away instead of waiting until they are needed
+	Logger::log(L"Start creating Display List");
+	Docanto::Timer time;
 
-	// get the page that will be rendered
-	auto doc = pdf_obj->get();
-	// we have to do a fz call since we want to use the ctx.
-	// we can't use any other calls (like m_pdf->get_page()) since we would need to create a ctx
-	// wrapper which would be overkill for this scenario.
-	fz_page* p = fz_load_page(*ctx, *doc, static_cast<int>(page));
-	pdf_update_page(*ctx, reinterpret_cast<pdf_page*>(p));
-	fz_try(*ctx) {
-		// create a display list with all the draw calls and so on
-		list_annot = fz_new_display_list(*ctx, fz_bound_page(*ctx, p));
-		dev_annot = fz_new_list_device(*ctx, list_annot);
+	auto store = pimpl->get_list_store();
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	size_t total_saved_bytes = 0;
 
-		// run all three devices
+	for (size_t i = 0; i < amount_of_pages; i++) {
 		Timer time2;
-		fz_run_page_annots(*ctx, p, dev_annot, fz_identity, nullptr);
-		//Logger::log("Page ", page + 1, " Annots Rendered in ", time2);
+		std::optional<PageDisplayLists> lists;
+		{
+			// the context is not held while the lists are stored, the index has to be locked first
+			auto ctx = GlobalPDFContext::get_instance().get();
+			lists = pimpl->build_lists(*ctx, *pdf_obj, i, nullptr, store);
+		}
 
-		// get the list and add the lists
-		auto annotat = pimpl->m_page_annotat.get_write();
-		annotat->at(page) = std::make_unique<DisplayListWrapper>(std::move(list_annot));
-	} fz_always(*ctx) {
-		// flush the device
-		fz_close_device(*ctx, dev_annot);
-		fz_drop_device(*ctx, dev_annot);
-	} fz_catch(*ctx) {
-		Docanto::Logger::error("Could not process the PDF page");
+		if (lists.has_value()) {
+			// before the lists were shared every render thread had to hold its own copy
+			size_t list_bytes = lists->content->get_size() + lists->annotat->get_size();
+			size_t saved_bytes = list_bytes * (thread_manager->get_amount_threads() - 1);
+			total_saved_bytes += saved_bytes;
+			Logger::log("Page ", i + 1, " Display lists built in ", time2, " use ", list_bytes / 1024, "KiB, sharing them saves ", saved_bytes / 1024, "KiB");
+		}
+
+		pimpl->store_display_lists(i, std::move(lists));
 	}
-	// always drop page at the end
-	fz_drop_page(*ctx, p);
 
+	Logger::log(L"Finished Displaylist in ", time, " and saved ", total_saved_bytes / 1024, "KiB by sharing them across ", thread_manager->get_amount_threads(), " render threads");
 }
 
-void Docanto::PDFRenderer::reload() {
-	// first remove all lists
+void Docanto::PDFRenderer::update_parallel(size_t amount_threads) {
+	if (amount_threads == 0) {
+		amount_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	Docanto::Timer time;
 	size_t amount_of_pages = pdf_obj->get_page_count();
+	amount_threads = std::clamp<size_t>(amount_threads, 1, std::max<size_t>(amount_of_pages, 1));
+
+	// every slot is only written by the thread which took the page
+	std::vector<std::optional<PageDisplayLists>> content(amount_of_pages);
+	std::atomic_size_t next_page = 0;
+	auto store = pimpl->get_list_store();
+
+	auto build_content = [&]() {
+		fz_context* ctx;
+		{
+			auto c = GlobalPDFContext::get_instance().get();
+			ctx = fz_clone_context(*c);
+		}
+
+		// each thread opens its own document over the same buffer, so no thread has to wait for the document lock
+		fz_document* doc = nullptr;
+		fz_stream* stream = nullptr;
+		fz_try(ctx) {
+			stream = fz_open_memory(ctx, pdf_obj->data.get(), pdf_obj->size);
+			doc = fz_open_document_with_stream(ctx, ".pdf", stream);
+		} fz_always(ctx) {
+			fz_drop_stream(ctx, stream);
+		} fz_catch(ctx) {
+			Docanto::Logger::error("Could not open the document for building the display lists");
+		}
+
+		if (doc != nullptr) {
+			for (size_t page = next_page++; page < amount_of_pages; page = next_page++) {
+				auto cached = store == nullptr ? nullptr : DisplayListFormat::load(ctx, *store, pimpl->m_content_hash, page);
+				if (cached != nullptr) {
+					content.at(page) = PageDisplayLists{ std::make_shared<DisplayListWrapper>(cached), nullptr, nullptr };
+					continue;
+				}
+
+				content.at(page) = record_page_lists(ctx, doc, page, PAGE_LAYER_CONTENT);
+				if (store != nullptr and content.at(page).has_value()) {
+					DisplayListFormat::store(*store, content.at(page)->content->list, pimpl->m_content_hash, page);
+				}
+			}
+			fz_drop_document(ctx, doc);
+		}
+
+		fz_drop_context(ctx);
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < amount_threads; i++) {
+		workers.emplace_back(build_content);
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	Logger::log("Built the content of ", amount_of_pages, " pages on ", amount_threads, " threads in ", time);
 
+	// the annotations may have been changed since the file was loaded, they are taken from the main document
 	for (size_t i = 0; i < amount_of_pages; i++) {
-		auto job1 = std::make_shared<RenderThreadManager::RenderJob>();
-		job1->job = RenderThreadManager::JobType::DELETE_DISPLAY_LIST;
-		job1->info.page = i;
+		std::optional<PageDisplayLists> lists;
+		{
+			auto ctx = GlobalPDFContext::get_instance().get();
+			auto doc = pdf_obj->get();
+			lists = record_page_lists(*ctx, *doc, i, PAGE_LAYER_WIDGETS | PAGE_LAYER_ANNOTATIONS);
+		}
+
+		if (lists.has_value() and content.at(i).has_value()) {
+			lists->content = content.at(i)->content;
+		}
+		else {
+			lists.reset();
+		}
+
+		pimpl->store_display_lists(i, std::move(lists));
+	}
 
-		job1->type = RenderThreadManager::ContentType::ANNOTATION;
+	Logger::log(L"Finished Displaylist in ", time, " using ", amount_threads, " threads");
+}
+
+bool Docanto::PDFRenderer::is_page_ready(size_t page) {
+	return pimpl->m_page_content.get_read()->at(page) != nullptr;
+}
+
+void Docanto::PDFRenderer::update_page_annotations(size_t page) {
+	// the lists of the annotations which did not change are taken over
+	auto previous = pimpl->m_page_annotat.get_read()->at(page);
 
-		auto job2 = std::make_shared<RenderThreadManager::RenderJob>();
-		job2->job = RenderThreadManager::JobType::DELETE_DISPLAY_LIST;
-		job2->info.page = i;
+	std::shared_ptr<DisplayListWrapper> layer;
+	{
+		auto ctx = GlobalPDFContext::get_instance().get();
+		auto doc = pdf_obj->get();
 
-		job2->type = RenderThreadManager::ContentType::CONTENT;
+		fz_page* p = nullptr;
+		fz_try(*ctx) {
+			p = fz_load_page(*ctx, *doc, static_cast<int>(page));
+		} fz_catch(*ctx) {
+			Docanto::Logger::error("Could not process the PDF page");
+			return;
+		}
 
-		thread_manager->add_job(id, job1);
-		thread_manager->add_job(id, job2);
+		layer = record_annotation_layer(*ctx, p, previous.get(), nullptr);
+		// always drop page at the end
+		fz_drop_page(*ctx, p);
 	}
 
-	// remove the display lists
-	pimpl->m_page_annotat.get_write()->clear();
-	pimpl->m_page_content.get_write()->clear();
-	pimpl->m_page_widgets.get_write()->clear();
+	if (layer != nullptr) {
+		// a list build which is still running recorded the old annotations, it must not overwrite the new layer
+		auto tiles = pimpl->m_tiles.get();
+		pimpl->m_page_annotat.get_write()->at(page) = layer;
+		tiles->pages.at(page).annot_revision++;
+	}
+}
 
+void Docanto::PDFRenderer::reload() {
+	auto tiles = pimpl->m_tiles.get();
 
-	// remove any bitmaps
-	auto content_bitmaps = pimpl->m_highDefBitmaps.get_write();
-	for (size_t i = 0; i < content_bitmaps->size(); i++) {
-		auto& d = content_bitmaps->at(i);
-		remove_from_processor(d.id);
+	// remove the display lists, they are built again once the pages are requested. Jobs which are
+	// still queued keep their list alive, but their result would show the old content so they are aborted
+	size_t amount_of_pages = pdf_obj->get_page_count();
+	pimpl->m_page_annotat.get_write()->assign(amount_of_pages, nullptr);
+	pimpl->m_page_content.get_write()->assign(amount_of_pages, nullptr);
+	pimpl->m_page_widgets.get_write()->assign(amount_of_pages, nullptr);
+
+	for (auto& [_, job] : tiles->jobs) {
+		job->cookie.abort = 1;
+	}
+	tiles->jobs.clear();
+	for (auto& page_tiles : tiles->pages) {
+		page_tiles.jobs.clear();
+
+		if (page_tiles.list_job != nullptr) {
+			page_tiles.list_job->cookie.abort = 1;
+			page_tiles.list_job = nullptr;
+		}
+		page_tiles.list_state = impl::ListState::MISSING;
 	}
 
+	// remove any bitmaps, the drawn ones and the ones only the cache knows about
+	auto content_bitmaps = pimpl->m_highDefBitmaps.get_write();
 	auto annota_bitmaps = pimpl->m_annotationBitmaps.get_write();
-	for (size_t i = 0; i < annota_bitmaps->size(); i++) {
-		auto& d = annota_bitmaps->at(i);
-		remove_from_processor(d.id);
+
+	auto previews = pimpl->m_previewbitmaps.get_write();
+
+	auto cached = pimpl->m_tile_cache.clear();
+	pimpl->m_mips.get()->clear();
+	std::unordered_set<size_t> ids_to_delete(cached.begin(), cached.end());
+	for (const auto& d : *previews) {
+		ids_to_delete.insert(d.id);
+	}
+	for (const auto& d : *content_bitmaps) {
+		ids_to_delete.insert(d.id);
+	}
+	for (const auto& d : *annota_bitmaps) {
+		ids_to_delete.insert(d.id);
+	}
+
+	for (auto image_id : ids_to_delete) {
+		m_processor->deleteImage(image_id);
 	}
 
 	content_bitmaps->clear();
 	annota_bitmaps->clear();
-
-	// redo them
-	update();
+	previews->clear();
+	for (auto& page_tiles : tiles->pages) {
+		page_tiles.bitmaps.clear();
+		page_tiles.preview.reset();
+		page_tiles.preview_bytes = 0;
+
+		// the content may have changed, so the costs are measured again
+		page_tiles.costs = {};
+		page_tiles.cost_revision++;
+		page_tiles.layouts.clear();
+	}
+	pimpl->m_previews_dirty = true;
 }
 
 void Docanto::PDFRenderer::reload_annotations_page(size_t page) {
-	//Docanto::Logger::log("-- Reloading Annotations --");
-	//abort_all_items();
-	auto job2 = std::make_shared<RenderThreadManager::RenderJob>();
-	job2->job = RenderThreadManager::JobType::DELETE_DISPLAY_LIST;
-	job2->info.page = page;
+	reload_annotations_page(page, { Geometry::Rectangle<float>({ 0, 0 }, pdf_obj->get_page_dimension(page)) });
+}
 
-	job2->type = RenderThreadManager::ContentType::ANNOTATION;
+void Docanto::PDFRenderer::reload_annotations_page(size_t page, const std::vector<Geometry::Rectangle<float>>& areas) {
+	update_page_annotations(page);
 
-	thread_manager->add_job(id, job2);
+	auto dims = pdf_obj->get_page_dimension(page);
+	auto tiles = pimpl->m_tiles.get();
+	auto annotation_layer = static_cast<size_t>(RenderThreadManager::ContentType::ANNOTATION);
 
-	update_page_annotations(page);
+	auto is_changed = [&areas](const Geometry::Rectangle<float>& rec) {
+		return std::any_of(areas.begin(), areas.end(), [&rec](const auto& area) { return area.intersects(rec); });
+	};
+
+	// queued jobs still hold the old list so the ones which cover a changed area have to be redone
+	std::vector<size_t> outdated_jobs;
+	for (const auto& [key, job] : tiles->pages.at(page).jobs) {
+		if (key.layer == annotation_layer and is_changed(job->info.recs)) {
+			job->cookie.abort = 1;
+			outdated_jobs.push_back(job->info.id);
+		}
+	}
+	for (auto job_id : outdated_jobs) {
+		tiles->remove_job(job_id);
+	}
+
+	// the cached annotation tiles over the changed areas are outdated. The ones which are drawn are kept
+	// until the new tiles replace them, all others can be deleted right away
+	auto outdated = pimpl->m_tile_cache.remove_if([&](const PDFTileCache::TileKey& key) {
+		return key.page == page and key.layer == annotation_layer and is_changed(get_tile_rec(key, dims));
+	});
+	std::unordered_set<size_t> ids_to_delete(outdated.begin(), outdated.end());
+	pimpl->m_mips.get()->remove_if([&](const PDFTileCache::TileKey& key) {
+		return key.page == page and key.layer == annotation_layer and is_changed(get_tile_rec(key, dims));
+	});
 
 	auto annota_bitmaps = pimpl->m_annotationBitmaps.get_write();
 	for (size_t i = 0; i < annota_bitmaps->size(); i++) {
 		auto& d = annota_bitmaps->at(i);
-		if (d.page != page) {
+		if (d.page != page or !is_changed(d.recs)) {
 			continue;
 		}
 		d.dpi = 0.0f;
+		ids_to_delete.erase(d.id);
+	}
+
+	for (auto& [key, d] : tiles->pages.at(page).bitmaps) {
+		if (key.layer == annotation_layer and is_changed(d.recs)) {
+			d.dpi = 0.0f;
+		}
+	}
+
+	for (auto image_id : ids_to_delete) {
+		m_processor->deleteImage(image_id);
 	}
 }
@@ -0,0 +1,214 @@
+#include "PDFTileCache.h"
+
+#include <list>
+#include <unordered_map>
+
+struct Docanto::PDFTileCache::impl {
+	struct Entry {
+		TileKey key;
+		size_t image_id = 0;
+		size_t bytes = 0;
+		bool pinned = true;
+		// inserted without a pin and not drawn yet
+		bool prefetched = false;
+	};
+
+	// the front of the list is the most recently used tile
+	std::list<Entry> m_lru;
+	std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> m_tiles;
+	mutable std::mutex m_mutex;
+
+	size_t m_budget = 0;
+	size_t m_bytes = 0;
+	size_t m_prefetched_bytes = 0;
+
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+	size_t m_evictions = 0;
+
+	size_t erase(std::list<Entry>::iterator it) {
+		auto id = it->image_id;
+		m_bytes -= it->bytes;
+		if (it->prefetched) {
+			m_prefetched_bytes -= it->bytes;
+		}
+		m_tiles.erase(it->key);
+		m_lru.erase(it);
+		return id;
+	}
+};
+
+size_t Docanto::PDFTileCache::TileKeyHash::operator()(const TileKey& k) const {
+	// boost style hash combine
+	size_t seed = 0;
+	auto combine = [&seed](size_t v) {
+		seed ^= std::hash<size_t>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	};
+
+	combine(k.document);
+	combine(k.page);
+	combine(k.zoom);
+	combine(k.level);
+	combine(k.x);
+	combine(k.y);
+	combine(k.layer);
+	return seed;
+}
+
+Docanto::PDFTileCache::PDFTileCache(size_t budget) : pimpl(std::make_unique<impl>()) {
+	pimpl->m_budget = budget;
+}
+
+Docanto::PDFTileCache::~PDFTileCache() = default;
+
+void Docanto::PDFTileCache::set_budget(size_t bytes) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	pimpl->m_budget = bytes;
+}
+
+size_t Docanto::PDFTileCache::get_budget() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_budget;
+}
+
+std::optional<size_t> Docanto::PDFTileCache::insert(const TileKey& key, size_t image_id, size_t bytes, bool pin) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	std::optional<size_t> replaced;
+
+	auto it = pimpl->m_tiles.find(key);
+	if (it != pimpl->m_tiles.end()) {
+		replaced = pimpl->erase(it->second);
+	}
+
+	pimpl->m_lru.push_front({ key, image_id, bytes, pin, !pin });
+	pimpl->m_tiles[key] = pimpl->m_lru.begin();
+	pimpl->m_bytes += bytes;
+	if (!pin) {
+		pimpl->m_prefetched_bytes += bytes;
+	}
+
+	return replaced;
+}
+
+std::optional<size_t> Docanto::PDFTileCache::lookup(const TileKey& key, bool pin) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	auto it = pimpl->m_tiles.find(key);
+	if (it == pimpl->m_tiles.end()) {
+		pimpl->m_misses++;
+		return std::nullopt;
+	}
+
+	pimpl->m_hits++;
+	// move it to the front
+	pimpl->m_lru.splice(pimpl->m_lru.begin(), pimpl->m_lru, it->second);
+	it->second->pinned = it->second->pinned or pin;
+	if (pin and it->second->prefetched) {
+		it->second->prefetched = false;
+		pimpl->m_prefetched_bytes -= it->second->bytes;
+	}
+
+	return it->second->image_id;
+}
+
+bool Docanto::PDFTileCache::contains(const TileKey& key) const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_tiles.contains(key);
+}
+
+bool Docanto::PDFTileCache::unpin(const TileKey& key, size_t image_id) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	auto it = pimpl->m_tiles.find(key);
+	if (it == pimpl->m_tiles.end() or it->second->image_id != image_id) {
+		return false;
+	}
+
+	it->second->pinned = false;
+	return true;
+}
+
+std::optional<size_t> Docanto::PDFTileCache::remove(const TileKey& key) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	auto it = pimpl->m_tiles.find(key);
+	if (it == pimpl->m_tiles.end()) {
+		return std::nullopt;
+	}
+
+	return pimpl->erase(it->second);
+}
+
+std::vector<size_t> Docanto::PDFTileCache::remove_if(std::function<bool(const TileKey&)> pred) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	std::vector<size_t> ids;
+
+	for (auto it = pimpl->m_lru.begin(); it != pimpl->m_lru.end();) {
+		auto next = std::next(it);
+		if (pred(it->key)) {
+			ids.push_back(pimpl->erase(it));
+		}
+		it = next;
+	}
+
+	return ids;
+}
+
+std::vector<size_t> Docanto::PDFTileCache::evict() {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	std::vector<size_t> ids;
+
+	// walk from the least recently used tile to the front, pinned tiles are skipped
+	auto it = pimpl->m_lru.end();
+	while (pimpl->m_bytes > pimpl->m_budget and it != pimpl->m_lru.begin()) {
+		it--;
+		if (it->pinned) {
+			continue;
+		}
+
+		auto to_erase = it;
+		it++;
+		ids.push_back(pimpl->erase(to_erase));
+		pimpl->m_evictions++;
+	}
+
+	return ids;
+}
+
+std::vector<size_t> Docanto::PDFTileCache::clear() {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	std::vector<size_t> ids;
+	ids.reserve(pimpl->m_lru.size());
+
+	for (const auto& entry : pimpl->m_lru) {
+		ids.push_back(entry.image_id);
+	}
+
+	pimpl->m_lru.clear();
+	pimpl->m_tiles.clear();
+	pimpl->m_bytes = 0;
+	pimpl->m_prefetched_bytes = 0;
+
+	return ids;
+}
+
+Docanto::PDFTileCache::Statistics Docanto::PDFTileCache::get_statistics() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	Statistics stats;
+	stats.hits = pimpl->m_hits;
+	stats.misses = pimpl->m_misses;
+	stats.evictions = pimpl->m_evictions;
+	stats.amount_tiles = pimpl->m_tiles.size();
+	stats.amount_pinned = std::count_if(pimpl->m_lru.begin(), pimpl->m_lru.end(), [](const auto& e) { return e.pinned; });
+	stats.bytes = pimpl->m_bytes;
+	stats.prefetched_bytes = pimpl->m_prefetched_bytes;
+	stats.budget = pimpl->m_budget;
+
+	return stats;
+}
+
+size_t Docanto::PDFTileCache::get_prefetched_bytes() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_prefetched_bytes;
+}
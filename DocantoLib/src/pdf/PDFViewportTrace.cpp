@@ -0,0 +1,176 @@
+#include "PDFViewportTrace.h"
+
+#include "../../include/general/Logger.h"
+
+#include <chrono>
+#include <limits>
+#include <sstream>
+
+namespace {
+	constexpr const char* TRACE_HEADER = "docanto-trace";
+	constexpr size_t TRACE_VERSION = 1;
+}
+
+struct Docanto::PDFViewportTrace::impl {
+	typedef std::chrono::steady_clock clock;
+
+	clock::time_point m_start = clock::now();
+	std::vector<Document> m_documents;
+	std::vector<Event> m_events;
+
+	mutable std::mutex m_mutex;
+
+	double now() const {
+		return std::chrono::duration<double, std::milli>(clock::now() - m_start).count();
+	}
+};
+
+Docanto::PDFViewportTrace::PDFViewportTrace() : pimpl(std::make_unique<impl>()) {}
+
+Docanto::PDFViewportTrace::~PDFViewportTrace() = default;
+
+void Docanto::PDFViewportTrace::add_document(size_t id, const std::filesystem::path& path) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	auto& docs = pimpl->m_documents;
+	if (std::any_of(docs.begin(), docs.end(), [id](const Document& d) { return d.id == id; })) {
+		return;
+	}
+	docs.push_back({ id, path });
+}
+
+void Docanto::PDFViewportTrace::record_request(size_t document, const Geometry::Rectangle<float>& view, float dpi) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	Event e;
+	e.type = Event::Type::REQUEST;
+	e.time_ms = pimpl->now();
+	e.document = document;
+	e.view = view;
+	e.dpi = dpi;
+	pimpl->m_events.push_back(e);
+}
+
+void Docanto::PDFViewportTrace::record_position(size_t document, size_t page, const Geometry::Point<float>& pos) {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	Event e;
+	e.type = Event::Type::POSITION;
+	e.time_ms = pimpl->now();
+	e.document = document;
+	e.view = { pos.x, pos.y, 0, 0 };
+	e.page = page;
+	pimpl->m_events.push_back(e);
+}
+
+std::vector<Docanto::PDFViewportTrace::Document> Docanto::PDFViewportTrace::get_documents() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_documents;
+}
+
+std::vector<Docanto::PDFViewportTrace::Event> Docanto::PDFViewportTrace::get_events() const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+	return pimpl->m_events;
+}
+
+bool Docanto::PDFViewportTrace::save(const std::filesystem::path& p) const {
+	std::scoped_lock<std::mutex> lock(pimpl->m_mutex);
+
+	std::error_code ec;
+	if (p.has_parent_path()) {
+		std::filesystem::create_directories(p.parent_path(), ec);
+	}
+
+	std::ofstream out(p);
+	if (!out) {
+		Logger::error("Could not write the viewport trace to ", p);
+		return false;
+	}
+
+	// the coordinates have to survive the round trip exactly
+	out.precision(std::numeric_limits<float>::max_digits10);
+	out << TRACE_HEADER << " " << TRACE_VERSION << "\n";
+
+	// the path is the rest of the line, so it may contain spaces
+	for (const auto& d : pimpl->m_documents) {
+		out << "document " << d.id << " " << reinterpret_cast<const char*>(d.path.u8string().c_str()) << "\n";
+	}
+
+	for (const auto& e : pimpl->m_events) {
+		if (e.type == Event::Type::REQUEST) {
+			out << "request " << e.time_ms << " " << e.document << " " << e.view.x << " " << e.view.y << " "
+				<< e.view.width << " " << e.view.height << " " << e.dpi << "\n";
+		}
+		else {
+			out << "position " << e.time_ms << " " << e.document << " " << e.page << " " << e.view.x << " " << e.view.y << "\n";
+		}
+	}
+
+	return static_cast<bool>(out);
+}
+
+std::shared_ptr<Docanto::PDFViewportTrace> Docanto::PDFViewportTrace::load(const std::filesystem::path& p) {
+	std::ifstream in(p);
+	if (!in) {
+		Logger::error("Could not open the viewport trace ", p);
+		return nullptr;
+	}
+
+	std::string header;
+	size_t version = 0;
+	in >> header >> version;
+	if (header != TRACE_HEADER or version != TRACE_VERSION) {
+		Logger::error("The file ", p, " is not a viewport trace of version ", TRACE_VERSION);
+		return nullptr;
+	}
+
+	auto trace = std::make_shared<PDFViewportTrace>();
+	auto& docs = trace->pimpl->m_documents;
+	auto& events = trace->pimpl->m_events;
+
+	std::string line;
+	size_t line_number = 1;
+	std::getline(in, line);
+	while (std::getline(in, line)) {
+		line_number++;
+		if (line.empty()) {
+			continue;
+		}
+
+		std::istringstream s(line);
+		std::string type;
+		s >> type;
+
+		if (type == "document") {
+			Document d;
+			s >> d.id;
+			s.ignore(1);
+
+			std::string path;
+			std::getline(s, path);
+			d.path = std::filesystem::path(std::u8string(path.begin(), path.end()));
+			docs.push_back(d);
+		}
+		else if (type == "request") {
+			Event e;
+			e.type = Event::Type::REQUEST;
+			s >> e.time_ms >> e.document >> e.view.x >> e.view.y >> e.view.width >> e.view.height >> e.dpi;
+			events.push_back(e);
+		}
+		else if (type == "position") {
+			Event e;
+			e.type = Event::Type::POSITION;
+			s >> e.time_ms >> e.document >> e.page >> e.view.x >> e.view.y;
+			events.push_back(e);
+		}
+		else {
+			s.setstate(std::ios::failbit);
+		}
+
+		if (s.fail()) {
+			Logger::error("Could not read line ", line_number, " of the viewport trace ", p);
+			return nullptr;
+		}
+	}
+
+	return trace;
+}
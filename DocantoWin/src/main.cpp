@@ -19,6 +19,7 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	FILE* fpstdout;
 	freopen_s(&fpstdout, "CONOUT$", "w", stdout);
 	Docanto::Logger::init(&std::wcout);
+	Docanto::ChromeTrace::get_instance().set_thread_name("UI");
 
 	std::atexit(exit_func);
 
@@ -5,24 +5,32 @@ using namespace Docanto;
 
 DocantoWin::PDFHandler::PDFHandler(const std::filesystem::path& p, std::shared_ptr<Direct2DRender> render) : m_render(render) {
 	m_pdfimageprocessor = std::make_shared<PDFHandlerImageProcessor>(render);
+	m_disk_cache = std::make_shared<PDFDiskTileCache>();
+	m_list_store = std::make_shared<DiskStore>(PDFDiskTileCache::get_default_directory().parent_path() / "lists", ".list", 256 * 1024 * 1024);
+	// a zoom finishes many tiles at once, the window is only repainted once per frame
+	m_render_notifier = std::make_shared<PDFRenderNotifier>([render](const PDFRenderNotifier::Batch& batch) {
+		PostMessage(render->get_attached_window()->get_hwnd(), WM_PAINT, 0, 0);
+	});
+	m_render_notifier->set_flush_on_complete(true);
+
 	auto pdf = std::make_shared<PDF>(p);
 	auto r = std::make_shared<PDFRenderer>(pdf, m_pdfimageprocessor);
+	r->set_disk_cache(m_disk_cache);
+	r->set_display_list_store(m_list_store);
+	r->set_render_notifier(m_render_notifier);
 	auto a = std::make_shared<PDFAnnotation>(pdf);
 	m_pdfobj.push_back({ pdf, r, a });
-
-	m_pdfobj.back().render->set_rendercallback([&](size_t i) {
-		PostMessage(m_render->get_attached_window()->get_hwnd(), WM_PAINT, 0, 0);
-		});
 }
 
 void DocantoWin::PDFHandler::add_pdf(const std::filesystem::path& p) {
 	auto pdf = std::make_shared<PDF>(p);
 	auto r = std::make_shared<PDFRenderer>(pdf, m_pdfimageprocessor);
+	r->set_disk_cache(m_disk_cache);
+	r->set_display_list_store(m_list_store);
+	r->set_render_notifier(m_render_notifier);
+	r->set_viewport_trace(m_viewport_trace);
 	auto a = std::make_shared<PDFAnnotation>(pdf);
 	m_pdfobj.push_back({ pdf, r, a});
-	m_pdfobj.back().render->set_rendercallback([&](size_t i) {
-		PostMessage(m_render->get_attached_window()->get_hwnd(), WM_PAINT, 0, 0);
-	});
 
 	auto max_width = 0;
 	for (size_t i = 0; i < m_pdfobj.size() - 1; i++) {
@@ -48,11 +56,25 @@ void DocantoWin::PDFHandler::draw(std::shared_ptr<Docanto::PDFRenderer> r) {
 		m_render->draw_rect_filled(r, {255, 255, 255});
 	}
 
-	auto& preview_info = r->get_preview();
+	// pages whose display lists are still being built are shown as a placeholder
+	auto page_recs = r->get_page_recs();
+	for (size_t i = 0; i < page_recs.size(); i++) {
+		if (!r->is_page_ready(i)) {
+			m_render->draw_rect_filled(page_recs.at(i), { 230, 230, 230 });
+		}
+	}
+
 	auto bitmaps = m_pdfimageprocessor->m_all_bitmaps.get();
 
+	// the previews are drawn first so there is never an empty page below the sharp tiles
+	auto preview_list = r->get_preview();
+	auto& preview_info = *preview_list;
+
 	for (const auto& info : preview_info) {
-		m_render->draw_bitmap(info.recs, bitmaps->at(info.id));
+		if (bitmaps->find(info.id) == bitmaps->end() or bitmaps->at(info.id).m_object == nullptr) {
+			continue;
+		}
+		m_render->draw_bitmap(info.recs + r->get_position(info.page), bitmaps->at(info.id));
 	}
 
 	auto list = r->draw();
@@ -94,6 +116,28 @@ void DocantoWin::PDFHandler::toggle_debug_draw() {
 	set_debug_draw(!m_debug_draw);
 }
 
+void DocantoWin::PDFHandler::toggle_viewport_trace() {
+	if (m_viewport_trace == nullptr) {
+		m_viewport_trace = std::make_shared<PDFViewportTrace>();
+		for (auto& obj : m_pdfobj) {
+			obj.render->set_viewport_trace(m_viewport_trace);
+		}
+		Logger::log("Started recording the viewport");
+		return;
+	}
+
+	for (auto& obj : m_pdfobj) {
+		obj.render->set_viewport_trace(nullptr);
+	}
+
+	auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	auto path = PDFDiskTileCache::get_default_directory().parent_path() / "traces" / ("viewport_" + std::to_string(seconds) + ".trace");
+	if (m_viewport_trace->save(path)) {
+		Logger::log("Saved the viewport trace to ", path);
+	}
+	m_viewport_trace = nullptr;
+}
+
 std::pair<DocantoWin::PDFHandler::PDFWrapper, size_t> DocantoWin::PDFHandler::get_pdf_at_point(Docanto::Geometry::Point<float> p) {
 	for (auto& obj : m_pdfobj) {
 		auto all_recs = obj.render->get_page_recs();
@@ -133,6 +177,19 @@ void DocantoWin::PDFHandler::request() {
 	auto dims = m_render->get_attached_window()->get_client_size();
 	auto local_rec =  m_render->inv_transform({ 0, 0, (float)dims.width * scale, (float)dims.height * scale});
 
+	// the document which fills most of the window gets the larger share of the render threads
+	PDFRenderer* active = nullptr;
+	float active_area = 0;
+	for (auto& obj : m_pdfobj) {
+		auto area = obj.render->get_visible_area(local_rec);
+		if (area > active_area) {
+			active = obj.render.get();
+			active_area = area;
+		}
+	}
+	if (active != nullptr and !active->is_active()) {
+		active->set_active();
+	}
 
 	for (auto& obj : m_pdfobj) {
 		obj.render->request(local_rec, m_render->get_transform_scale() * m_render->get_dpi());
@@ -26,6 +26,12 @@ namespace DocantoWin {
 		};
 
 		std::shared_ptr<PDFHandlerImageProcessor> m_pdfimageprocessor;
+		// the tiles of all documents are kept on the disk so reopening them is fast
+		std::shared_ptr<Docanto::PDFDiskTileCache> m_disk_cache;
+		std::shared_ptr<Docanto::DiskStore> m_list_store;
+		std::shared_ptr<Docanto::PDFRenderNotifier> m_render_notifier;
+		// set while the requests of all documents are recorded
+		std::shared_ptr<Docanto::PDFViewportTrace> m_viewport_trace;
 		std::shared_ptr<Direct2DRender> m_render;
 
 		bool m_debug_draw = false;
@@ -41,6 +47,12 @@ namespace DocantoWin {
 		void set_debug_draw(bool b = true);
 		void toggle_debug_draw();
 
+		/// <summary>
+		/// Starts recording the viewport of all documents. If a recording is running it is stopped
+		/// and written next to the disk tile cache.
+		/// </summary>
+		void toggle_viewport_trace();
+
 		void reload();
 
 		std::pair<PDFWrapper, size_t> get_pdf_at_point(Docanto::Geometry::Point<float> p);
@@ -65,7 +65,7 @@ void DocantoWin::ToolHandler::end_ink(Docanto::Geometry::Point<float> p) {
 		m_pdf_target.first.annotation->add_annotation(m_pdf_target.second, 
 			m_current_ink, get_current_tool().col, get_current_tool().width);
 
-		m_pdf_target.first.render->reload_annotations_page(m_pdf_target.second);
+		m_pdf_target.first.render->reload_annotations_page(m_pdf_target.second, m_pdf_target.first.annotation->take_changed_areas(m_pdf_target.second));
 
 		m_render->get_attached_window()->send_paint_request();
 	}
@@ -151,7 +151,7 @@ void DocantoWin::ToolHandler::selection_remove_from_pdf() {
 		m_pdf_target.first.annotation->remove_annotation(m_selection_annotations[i]);
 	}
 	m_selection_annotations.clear();
-	m_pdf_target.first.render->reload_annotations_page(m_pdf_target.second);
+	m_pdf_target.first.render->reload_annotations_page(m_pdf_target.second, m_pdf_target.first.annotation->take_changed_areas(m_pdf_target.second));
 	m_render->get_attached_window()->send_paint_request();
 }
 
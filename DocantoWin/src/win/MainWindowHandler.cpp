@@ -88,6 +88,28 @@ void DocantoWin::MainWindowHandler::key(Window::VK key, bool pressed) {
 		}
 		break;
 	}
+	case F8:
+	{
+		auto& trace = Docanto::ChromeTrace::get_instance();
+		if (!trace.is_enabled()) {
+			trace.start();
+			Docanto::Logger::log("Started recording the render trace");
+			break;
+		}
+
+		trace.stop();
+		auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		auto path = Docanto::PDFDiskTileCache::get_default_directory().parent_path() / "traces" / ("render_" + std::to_string(seconds) + ".json");
+		if (trace.save(path)) {
+			Docanto::Logger::log("Saved ", trace.get_amount_events(), " trace events to ", path);
+		}
+		break;
+	}
+	case F9:
+	{
+		m_ctx->tabs->get_active_tab()->pdfhandler->toggle_viewport_trace();
+		break;
+	}
 	case F10:
 	{
 		m_ctx->tabs->get_active_tab()->pdfhandler->toggle_debug_draw();